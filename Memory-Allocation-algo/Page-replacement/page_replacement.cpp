@@ -1,23 +1,53 @@
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <limits>
 #include <memory>
+#include <set>
+#include <span>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
+
+#include "simd_search.hpp"
+#include "trace_io.hpp"
 using namespace std;
 
 enum class ReplaceAlgo {
     Fifo_algo,
     Opt_algo,
     Lru_algo,
+    Clock_algo,
+    Esc_algo,
+    Arc_algo,
+    Lirs_algo,
+    TwoQ_algo,
+    Linux_algo,
+    Lfu_algo,
+    WsClock_algo,
+    Aging_algo,
 };
 
 struct Frame {
-    int page   = 0;
-    bool valid = false;
+    int page        = 0;
+    bool valid      = false;
+    bool dirty      = false;
+    bool prefetched = false; // brought in ahead of use and not referenced since
 };
 
+bool operator==(const Frame& a, const Frame& b) {
+    return a.valid == b.valid && (!a.valid || a.page == b.page);
+}
+
 struct AccessRes {
     bool hit;
     std::size_t victim;
@@ -26,209 +56,2319 @@ struct AccessRes {
     AccessRes(const bool h, const int intV) : hit(h), victim(static_cast<std::size_t>(intV)) {}
 };
 
+constexpr std::size_t noIndex = static_cast<std::size_t>(-1);
+
+// Links of an intrusive doubly-linked list over slot indices. The link array is owned by the
+// caller so several lists can share one pool of slots, as long as a slot is in one list at a time.
+struct Link {
+    std::size_t prev = noIndex;
+    std::size_t next = noIndex;
+};
+
+class IndexList {
+    std::size_t head_ = noIndex;
+    std::size_t tail_ = noIndex;
+    std::size_t size_ = 0;
+
+public:
+    bool empty() const { return size_ == 0; }
+    std::size_t size() const { return size_; }
+    std::size_t front() const { return head_; }
+    std::size_t back() const { return tail_; }
+
+    void pushFront(vector<Link>& links, std::size_t i) {
+        links[i].prev = noIndex;
+        links[i].next = head_;
+        if (head_ != noIndex) links[head_].prev = i;
+        else tail_ = i;
+        head_ = i;
+        ++size_;
+    }
+
+    void insertAfter(vector<Link>& links, std::size_t pos, std::size_t i) {
+        links[i].prev = pos;
+        links[i].next = links[pos].next;
+        if (links[pos].next != noIndex) links[links[pos].next].prev = i;
+        else tail_ = i;
+        links[pos].next = i;
+        ++size_;
+    }
+
+    void remove(vector<Link>& links, std::size_t i) {
+        if (links[i].prev != noIndex) links[links[i].prev].next = links[i].next;
+        else head_ = links[i].next;
+        if (links[i].next != noIndex) links[links[i].next].prev = links[i].prev;
+        else tail_ = links[i].prev;
+        links[i] = Link{};
+        --size_;
+    }
+
+    void moveToFront(vector<Link>& links, std::size_t i) {
+        if (head_ == i) return;
+        remove(links, i);
+        pushFront(links, i);
+    }
+};
+
+// Open-addressing page -> index table for a bounded number of entries. Linear probing with
+// backward-shift deletion keeps probe chains short without tombstones.
+class PageMap {
+    vector<int> keys_;
+    vector<std::size_t> vals_; // noIndex marks an empty slot
+    std::size_t mask_;
+    unsigned shift_;
+    std::size_t size_ = 0;
+
+    std::size_t slotOf(int page) const {
+        return static_cast<std::size_t>((static_cast<uint64_t>(static_cast<uint32_t>(page)) * 0x9E3779B97F4A7C15ULL) >> shift_);
+    }
+
+public:
+    explicit PageMap(std::size_t capacity) {
+        std::size_t slots = 8;
+        unsigned bits     = 3;
+        while (slots < capacity * 2) {
+            slots <<= 1;
+            ++bits;
+        }
+        keys_.assign(slots, 0);
+        vals_.assign(slots, noIndex);
+        mask_  = slots - 1;
+        shift_ = 64 - bits;
+    }
+
+    std::size_t size() const { return size_; }
+
+    std::size_t find(int page) const {
+        for (std::size_t i = slotOf(page);; i = (i + 1) & mask_) {
+            if (vals_[i] == noIndex) return noIndex;
+            if (keys_[i] == page) return vals_[i];
+        }
+    }
+
+    void assign(int page, std::size_t value) {
+        std::size_t i = slotOf(page);
+        while (vals_[i] != noIndex && keys_[i] != page) {
+            i = (i + 1) & mask_;
+        }
+        if (vals_[i] == noIndex) ++size_;
+        keys_[i] = page;
+        vals_[i] = value;
+    }
+
+    void erase(int page) {
+        std::size_t i = slotOf(page);
+        while (true) {
+            if (vals_[i] == noIndex) return;
+            if (keys_[i] == page) break;
+            i = (i + 1) & mask_;
+        }
+        --size_;
+        // Pull later members of the probe chain back into the hole unless that would move them
+        // in front of their home slot.
+        for (std::size_t j = (i + 1) & mask_; vals_[j] != noIndex; j = (j + 1) & mask_) {
+            const std::size_t home = slotOf(keys_[j]);
+            if (((j - home) & mask_) >= ((j - i) & mask_)) {
+                keys_[i] = keys_[j];
+                vals_[i] = vals_[j];
+                i        = j;
+            }
+        }
+        vals_[i] = noIndex;
+    }
+};
+
+// Write-back and prefetch accounting as pages are loaded into frames, whatever finds the pages.
+class FrameLoads {
+    std::size_t writeBacks_       = 0;
+    std::size_t unusedPrefetches_ = 0;
+    vector<int>* writtenPages_    = nullptr;
+
+public:
+    std::size_t writeBacks() const { return writeBacks_; }
+    // Prefetched pages evicted before anything referenced them.
+    std::size_t unusedPrefetches() const { return unusedPrefetches_; }
+    // Appends every page written back from now on to `pages`; nullptr stops it.
+    void recordWrittenPages(vector<int>* pages) { writtenPages_ = pages; }
+
+    // Writes a dirty frame back to backing store, leaving it clean and resident.
+    void clean(vector<Frame>& frames, std::size_t frame) {
+        if (frames[frame].dirty) {
+            frames[frame].dirty = false;
+            ++writeBacks_;
+            if (writtenPages_) writtenPages_->push_back(frames[frame].page);
+        }
+    }
+
+    // Puts `page` in `frame`, writing back and dropping whatever page the frame held before.
+    void load(vector<Frame>& frames, std::size_t frame, int page) {
+        clean(frames, frame);
+        unusedPrefetches_ += frames[frame].prefetched;
+        frames[frame].prefetched = false;
+        frames[frame].page       = page;
+        frames[frame].valid      = true;
+    }
+};
+
+// Page -> frame lookup plus a stack of empty frames, shared by every policy so that hit
+// detection and free-frame lookup are O(1) whatever the frame count.
+class ResidencyIndex : public FrameLoads {
+public:
+    // Up to this many frames, pages are found by a vector scan of slots_ rather than through map_.
+    // The scan grows linearly and PageMap does not, so they cross early; see `pr bench`.
+    static constexpr std::size_t packedLimit = 16;
+
+private:
+    static constexpr int emptySlot = numeric_limits<int>::min();
+
+    PageMap map_;
+    vector<int> slots_;                // frame -> page, emptySlot when free; padded to a multiple of 8
+    std::size_t emptyPageFrame_ = noIndex; // a page numbered emptySlot cannot be found by the scan
+    bool packed_;
+    vector<std::size_t> free_;
+
+public:
+    explicit ResidencyIndex(int frameCount, bool packed = true)
+        : map_(frameCount), packed_(packed && static_cast<std::size_t>(frameCount) <= packedLimit) {
+        if (packed_) slots_.assign((static_cast<std::size_t>(frameCount) + 7) / 8 * 8, emptySlot);
+        // Hand out low frame indices first, matching the order frames were filled in before.
+        for (int i = frameCount; i-- > 0;) {
+            free_.push_back(static_cast<std::size_t>(i));
+        }
+    }
+
+    std::size_t find(int page) const {
+        if (!packed_) return map_.find(page);
+        if (page == emptySlot) return emptyPageFrame_;
+        const std::size_t frame = simd::findEqual(slots_.data(), slots_.size(), page);
+        return frame < slots_.size() ? frame : noIndex;
+    }
+
+    bool hasFree() const { return !free_.empty(); }
+
+    std::size_t takeFree() {
+        const std::size_t frame = free_.back();
+        free_.pop_back();
+        return frame;
+    }
+
+    // Places `page` in `frame`, writing back and dropping whatever page the frame held before.
+    void install(vector<Frame>& frames, std::size_t frame, int page) {
+        if (packed_) {
+            if (emptyPageFrame_ == frame) emptyPageFrame_ = noIndex;
+            if (page == emptySlot) emptyPageFrame_ = frame;
+            slots_[frame] = page;
+        } else {
+            if (frames[frame].valid) map_.erase(frames[frame].page);
+            map_.assign(page, frame);
+        }
+        load(frames, frame, page);
+    }
+};
+
 class AlgoState {
+protected:
+    std::size_t traceLength_ = 0;
+
 public:
     virtual ~AlgoState() = default;
-    virtual AccessRes access(int step, int page, vector<Frame>& frames, const vector<int>& ref) = 0;
+    virtual AccessRes access(int step, int page, vector<Frame>& frames, span<const int> ref) = 0;
+    // Policy-specific observations gathered over the run; most policies have none.
+    virtual void printStats(ostream& /*os*/) const {}
+
+    // One reference through the policy; a write leaves the page's frame dirty.
+    AccessRes reference(int step, int page, bool write, vector<Frame>& frames, span<const int> ref) {
+        const AccessRes res = access(step, page, frames, ref);
+        if (write) frames[res.hit ? frameOf(page) : res.victim].dirty = true;
+        return res;
+    }
+
+    // References pages[i] at step firstStep + i, as reference() would, and returns the hit count.
+    // Policies deriving from AlgoKernel run this without a virtual call per reference.
+    virtual std::size_t accessMany(int firstStep, span<const int> pages, span<const uint8_t> writes,
+                                   vector<Frame>& frames, span<const int> ref) {
+        std::size_t hits = 0;
+        for (std::size_t i = 0; i < pages.size(); ++i) {
+            hits += reference(firstStep + static_cast<int>(i), pages[i], !writes.empty() && writes[i], frames, ref).hit;
+        }
+        return hits;
+    }
+
+    // Brings a page in ahead of use, flagged as prefetched, in the step that referenced `current`;
+    // false if it was already resident or the policy declined it.
+    bool prefetch(int step, int page, int current, vector<Frame>& frames) {
+        if (frameOf(page) != noIndex) return false;
+        const std::size_t frame = insertPrefetched(step, page, frameOf(current), frames);
+        if (frame == noIndex) return false;
+        frames[frame].prefetched = true;
+        return true;
+    }
+
+    // Places a non-resident page that has not been referenced: it starts where the policy puts
+    // its coldest pages, and no reference bit, counter, adaptation or sampler moves. Returns its
+    // frame, or noIndex to drop the prefetch when the only victim on offer is frame `keep`.
+    virtual std::size_t insertPrefetched(int step, int page, std::size_t keep, vector<Frame>& frames) = 0;
+
+    // The whole trace's length when `ref` is only the current block, as in a streamed run.
+    void setTraceLength(std::size_t length) { traceLength_ = length; }
+
+    // The frame holding page, or noIndex.
+    virtual std::size_t frameOf(int page) const = 0;
+    virtual std::size_t writeBacks() const       = 0;
+    virtual std::size_t unusedPrefetches() const = 0;
+    // Pages written back, including those a hand cleans without evicting, are appended to `pages`.
+    virtual void recordWrittenPages(vector<int>* pages) = 0;
+
+protected:
+    std::size_t traceLength(span<const int> ref) const { return traceLength_ ? traceLength_ : ref.size(); }
+};
+
+// Base for the policies: accessMany calls Derived::access directly, so the per-reference path
+// of a batch is one inlined loop per policy instead of a virtual call per reference. Residency
+// finds resident pages and frames to fill; fixed-size policies bring their own.
+template <typename Derived, typename Residency = ResidencyIndex>
+class AlgoKernel : public AlgoState {
+protected:
+    Residency resident_;
+
+public:
+    AlgoKernel() = default;
+    explicit AlgoKernel(int frameCount) : resident_(frameCount) {}
+
+    std::size_t frameOf(int page) const final { return resident_.find(page); }
+    std::size_t writeBacks() const final { return resident_.writeBacks(); }
+    std::size_t unusedPrefetches() const final { return resident_.unusedPrefetches(); }
+    void recordWrittenPages(vector<int>* pages) final { resident_.recordWrittenPages(pages); }
+
+    std::size_t accessMany(int firstStep, span<const int> pages, span<const uint8_t> writes,
+                           vector<Frame>& frames, span<const int> ref) final {
+        auto& self       = static_cast<Derived&>(*this);
+        std::size_t hits = 0;
+        if (writes.empty()) {
+            for (std::size_t i = 0; i < pages.size(); ++i) {
+                hits += self.Derived::access(firstStep + static_cast<int>(i), pages[i], frames, ref).hit;
+            }
+            return hits;
+        }
+        for (std::size_t i = 0; i < pages.size(); ++i) {
+            const AccessRes res = self.Derived::access(firstStep + static_cast<int>(i), pages[i], frames, ref);
+            hits += res.hit;
+            if (writes[i]) frames[res.hit ? resident_.find(pages[i]) : res.victim].dirty = true;
+        }
+        return hits;
+    }
+};
+
+class FifoState final : public AlgoKernel<FifoState> {
+    std::size_t nextIndex_;
+
+public:
+    explicit FifoState(int frameCount) : AlgoKernel(frameCount), nextIndex_(0) {}
+
+    AccessRes access(int /*step*/, int page, vector<Frame>& frames, span<const int> /*ref*/) override {
+        if (resident_.find(page) != noIndex) {
+            return {true, -1};
+        }
+
+        if (resident_.hasFree()) {
+            const std::size_t frame = resident_.takeFree();
+            resident_.install(frames, frame, page);
+            return {false, frame};
+        }
+
+        const std::size_t victim = nextIndex_;
+        nextIndex_               = (nextIndex_ + 1) % frames.size();
+        resident_.install(frames, victim, page);
+        return {false, victim};
+    }
+
+    // FIFO order is load order, so a prefetch is loaded as a miss would be.
+    std::size_t insertPrefetched(int step, int page, std::size_t keep, vector<Frame>& frames) override {
+        if (!resident_.hasFree() && nextIndex_ == keep) return noIndex;
+        return access(step, page, frames, {}).victim;
+    }
+};
+
+class LruState final : public AlgoKernel<LruState> {
+    vector<Link> links_;
+    IndexList recency_; // front = most recently used frame
+
+public:
+    explicit LruState(int frameCount) : AlgoKernel(frameCount), links_(frameCount) {}
+
+    AccessRes access(int /*step*/, int page, vector<Frame>& frames, span<const int> /*ref*/) override {
+        if (const std::size_t frame = resident_.find(page); frame != noIndex) {
+            recency_.moveToFront(links_, frame);
+            return {true, -1};
+        }
+
+        std::size_t victim;
+        if (resident_.hasFree()) {
+            victim = resident_.takeFree();
+        } else {
+            victim = recency_.back();
+            recency_.remove(links_, victim);
+        }
+
+        resident_.install(frames, victim, page);
+        recency_.pushFront(links_, victim);
+        return {false, victim};
+    }
+
+    // LRU keeps no state besides recency, so a prefetch is loaded as a miss would be.
+    std::size_t insertPrefetched(int step, int page, std::size_t keep, vector<Frame>& frames) override {
+        if (!resident_.hasFree() && recency_.back() == keep) return noIndex;
+        return access(step, page, frames, {}).victim;
+    }
+};
+
+// Residency for policies built for a frame count fixed at compile time: a scan of a std::array
+// of N pages that the compiler fully unrolls, with frames filled in index order.
+template <std::size_t N>
+class FixedSlots : public FrameLoads {
+    static constexpr int emptySlot = numeric_limits<int>::min();
+
+    array<int, N> pages_;
+    std::size_t filled_         = 0;
+    std::size_t emptyPageFrame_ = noIndex; // a page numbered emptySlot cannot be found by the scan
+
+public:
+    FixedSlots() { pages_.fill(emptySlot); }
+
+    std::size_t find(int page) const {
+        if (page == emptySlot) return emptyPageFrame_;
+        std::size_t at = noIndex;
+        for (std::size_t i = N; i-- > 0;) at = pages_[i] == page ? i : at;
+        return at;
+    }
+
+    bool hasFree() const { return filled_ < N; }
+    std::size_t takeFree() { return filled_++; }
+
+    void install(vector<Frame>& frames, std::size_t frame, int page) {
+        if (emptyPageFrame_ == frame) emptyPageFrame_ = noIndex;
+        if (page == emptySlot) emptyPageFrame_ = frame;
+        pages_[frame] = page;
+        load(frames, frame, page);
+    }
+};
+
+template <std::size_t N>
+class FixedFifoState final : public AlgoKernel<FixedFifoState<N>, FixedSlots<N>> {
+    using AlgoKernel<FixedFifoState, FixedSlots<N>>::resident_;
+
+    std::size_t hand_ = 0;
+
+public:
+    AccessRes access(int /*step*/, int page, vector<Frame>& frames, span<const int> /*ref*/) override {
+        if (resident_.find(page) != noIndex) return {true, -1};
+
+        std::size_t victim;
+        if (resident_.hasFree()) {
+            victim = resident_.takeFree();
+        } else {
+            victim = hand_;
+            hand_  = hand_ + 1 == N ? 0 : hand_ + 1;
+        }
+        resident_.install(frames, victim, page);
+        return {false, victim};
+    }
+
+    std::size_t insertPrefetched(int step, int page, std::size_t keep, vector<Frame>& frames) override {
+        if (!resident_.hasFree() && hand_ == keep) return noIndex;
+        return access(step, page, frames, {}).victim;
+    }
+};
+
+template <std::size_t N>
+class FixedLruState final : public AlgoKernel<FixedLruState<N>, FixedSlots<N>> {
+    using AlgoKernel<FixedLruState, FixedSlots<N>>::resident_;
+
+    static constexpr std::size_t none = N;
+
+    // Recency order as a doubly linked list over frame indices, most recent at head_.
+    array<std::size_t, N> prev_{};
+    array<std::size_t, N> next_{};
+    std::size_t head_ = none;
+    std::size_t tail_ = none;
+
+    void pushFront(std::size_t frame) {
+        prev_[frame] = none;
+        next_[frame] = head_;
+        if (head_ != none) prev_[head_] = frame;
+        else tail_ = frame;
+        head_ = frame;
+    }
+
+    void unlink(std::size_t frame) {
+        if (prev_[frame] != none) next_[prev_[frame]] = next_[frame];
+        else head_ = next_[frame];
+        if (next_[frame] != none) prev_[next_[frame]] = prev_[frame];
+        else tail_ = prev_[frame];
+    }
+
+public:
+    AccessRes access(int /*step*/, int page, vector<Frame>& frames, span<const int> /*ref*/) override {
+        if (const std::size_t found = resident_.find(page); found != noIndex) {
+            if (found != head_) {
+                unlink(found);
+                pushFront(found);
+            }
+            return {true, -1};
+        }
+
+        std::size_t victim;
+        if (resident_.hasFree()) {
+            victim = resident_.takeFree();
+        } else {
+            victim = tail_;
+            unlink(victim);
+        }
+        pushFront(victim);
+        resident_.install(frames, victim, page);
+        return {false, victim};
+    }
+
+    std::size_t insertPrefetched(int step, int page, std::size_t keep, vector<Frame>& frames) override {
+        if (!resident_.hasFree() && tail_ == keep) return noIndex;
+        return access(step, page, frames, {}).victim;
+    }
+};
+
+// The fixed-size build of a policy when frameCount is one of the common small counts, otherwise
+// the general one.
+template <template <std::size_t> class Fixed, typename General>
+unique_ptr<AlgoState> newSizedState(int frameCount) {
+    switch (frameCount) {
+        case 3: return make_unique<Fixed<3>>();
+        case 4: return make_unique<Fixed<4>>();
+        case 8: return make_unique<Fixed<8>>();
+        case 16: return make_unique<Fixed<16>>();
+        default: return make_unique<General>(frameCount);
+    }
+}
+
+// result[i] is the next position after i that references ref[i], or ref.size() if none.
+vector<int> nextUseIndices(span<const int> ref) {
+    vector<int> nextUse(ref.size(), static_cast<int>(ref.size()));
+    unordered_map<int, int> seen;
+    seen.reserve(ref.size());
+    for (std::size_t i = ref.size(); i-- > 0;) {
+        auto [it, inserted] = seen.try_emplace(ref[i], static_cast<int>(i));
+        if (!inserted) {
+            nextUse[i] = it->second;
+            it->second = static_cast<int>(i);
+        }
+    }
+    return nextUse;
+}
+
+class OptState final : public AlgoKernel<OptState> {
+    vector<int> nextUse_;
+    // Next use of the page held in each frame, mirrored in byNextUse_ so the victim is its last element.
+    vector<int> frameNext_;
+
+    struct LaterUse {
+        bool operator()(const pair<int, int>& a, const pair<int, int>& b) const {
+            // Ties only happen between pages that are never used again; prefer the lowest frame index.
+            return a.first != b.first ? a.first < b.first : a.second > b.second;
+        }
+    };
+    set<pair<int, int>, LaterUse> byNextUse_;
+
+    void setNextUse(std::size_t frame, int nextUse) {
+        byNextUse_.erase({frameNext_[frame], static_cast<int>(frame)});
+        frameNext_[frame] = nextUse;
+        byNextUse_.insert({nextUse, static_cast<int>(frame)});
+    }
+
+public:
+    explicit OptState(int frameCount) : AlgoKernel(frameCount), frameNext_(frameCount, -1) {}
+
+    AccessRes access(int step, int page, vector<Frame>& frames, span<const int> ref) override {
+        if (nextUse_.size() != ref.size()) {
+            nextUse_ = nextUseIndices(ref);
+        }
+
+        if (const std::size_t frame = resident_.find(page); frame != noIndex) {
+            setNextUse(frame, nextUse_[step]);
+            return {true, -1};
+        }
+
+        const std::size_t victim = resident_.hasFree()
+                                       ? resident_.takeFree()
+                                       : static_cast<std::size_t>(prev(byNextUse_.end())->second);
+        resident_.install(frames, victim, page);
+        setNextUse(victim, nextUse_[step]);
+        return {false, victim};
+    }
+
+    // OPT already knows every future reference; checkCommand keeps it away from prefetching.
+    std::size_t insertPrefetched(int /*step*/, int /*page*/, std::size_t /*keep*/, vector<Frame>& /*frames*/) override {
+        return noIndex;
+    }
+};
+
+// Second chance with a circular hand: a referenced frame has its bit cleared and is skipped once.
+// Every hand step clears a bit set by an earlier access, so the movement is O(1) amortized.
+class ClockState final : public AlgoKernel<ClockState> {
+    vector<char> referenced_;
+    std::size_t hand_ = 0;
+
+    // Moves the hand past referenced frames, clearing them, and past `keep`; returns the frame
+    // it takes.
+    std::size_t sweep(std::size_t frameCount, std::size_t keep = noIndex) {
+        while (referenced_[hand_] || hand_ == keep) {
+            referenced_[hand_] = 0;
+            hand_              = (hand_ + 1) % frameCount;
+        }
+        const std::size_t victim = hand_;
+        hand_                    = (hand_ + 1) % frameCount;
+        return victim;
+    }
+
+public:
+    explicit ClockState(int frameCount) : AlgoKernel(frameCount), referenced_(frameCount, 0) {}
+
+    AccessRes access(int /*step*/, int page, vector<Frame>& frames, span<const int> /*ref*/) override {
+        if (const std::size_t frame = resident_.find(page); frame != noIndex) {
+            referenced_[frame] = 1;
+            return {true, -1};
+        }
+
+        const std::size_t victim = resident_.hasFree() ? resident_.takeFree() : sweep(frames.size());
+        resident_.install(frames, victim, page);
+        referenced_[victim] = 1;
+        return {false, victim};
+    }
+
+    std::size_t insertPrefetched(int /*step*/, int page, std::size_t keep, vector<Frame>& frames) override {
+        std::size_t victim;
+        if (resident_.hasFree()) {
+            victim = resident_.takeFree();
+        } else {
+            if (frames.size() == 1) return noIndex;
+            victim = sweep(frames.size(), keep);
+        }
+        resident_.install(frames, victim, page);
+        referenced_[victim] = 0;
+        return victim;
+    }
+};
+
+template <std::size_t N>
+class FixedClockState final : public AlgoKernel<FixedClockState<N>, FixedSlots<N>> {
+    using AlgoKernel<FixedClockState, FixedSlots<N>>::resident_;
+
+    array<char, N> referenced_{};
+    std::size_t hand_ = 0;
+
+    std::size_t sweep(std::size_t keep = noIndex) {
+        while (referenced_[hand_] || hand_ == keep) {
+            referenced_[hand_] = 0;
+            hand_              = hand_ + 1 == N ? 0 : hand_ + 1;
+        }
+        const std::size_t victim = hand_;
+        hand_                    = hand_ + 1 == N ? 0 : hand_ + 1;
+        return victim;
+    }
+
+public:
+    AccessRes access(int /*step*/, int page, vector<Frame>& frames, span<const int> /*ref*/) override {
+        if (const std::size_t frame = resident_.find(page); frame != noIndex) {
+            referenced_[frame] = 1;
+            return {true, -1};
+        }
+
+        const std::size_t victim = resident_.hasFree() ? resident_.takeFree() : sweep();
+        resident_.install(frames, victim, page);
+        referenced_[victim] = 1;
+        return {false, victim};
+    }
+
+    std::size_t insertPrefetched(int /*step*/, int page, std::size_t keep, vector<Frame>& frames) override {
+        const std::size_t victim = resident_.hasFree() ? resident_.takeFree() : sweep(keep);
+        resident_.install(frames, victim, page);
+        referenced_[victim] = 0;
+        return victim;
+    }
 };
 
-class FifoState final : public AlgoState {
-    int nextIndex_;
+// Enhanced second chance over (referenced, dirty): the hand clears one bit per step and takes the
+// first clean, unreferenced frame.
+class EscState final : public AlgoKernel<EscState> {
+    vector<char> referenced_;
+    std::size_t hand_ = 0;
+
+    // Moves the hand until it reaches a clean, unreferenced frame other than `keep`, and takes it.
+    std::size_t sweep(vector<Frame>& frames, std::size_t keep = noIndex) {
+        while (referenced_[hand_] || frames[hand_].dirty || hand_ == keep) {
+            if (referenced_[hand_]) referenced_[hand_] = 0;
+            else resident_.clean(frames, hand_);
+            hand_ = (hand_ + 1) % frames.size();
+        }
+        const std::size_t victim = hand_;
+        hand_                    = (hand_ + 1) % frames.size();
+        return victim;
+    }
 
 public:
-    explicit FifoState(int /*frameCount*/) : nextIndex_(0) {}
+    explicit EscState(int frameCount) : AlgoKernel(frameCount), referenced_(frameCount, 0) {}
+
+    AccessRes access(int /*step*/, int page, vector<Frame>& frames, span<const int> /*ref*/) override {
+        if (const std::size_t frame = resident_.find(page); frame != noIndex) {
+            referenced_[frame] = 1;
+            return {true, -1};
+        }
+
+        const std::size_t victim = resident_.hasFree() ? resident_.takeFree() : sweep(frames);
+        resident_.install(frames, victim, page);
+        referenced_[victim] = 1;
+        return {false, victim};
+    }
+
+    std::size_t insertPrefetched(int /*step*/, int page, std::size_t keep, vector<Frame>& frames) override {
+        std::size_t victim;
+        if (resident_.hasFree()) {
+            victim = resident_.takeFree();
+        } else {
+            if (frames.size() == 1) return noIndex;
+            victim = sweep(frames, keep);
+        }
+        resident_.install(frames, victim, page);
+        referenced_[victim] = 0;
+        return victim;
+    }
+};
+
+// ARC (Megiddo & Modha): T1/T2 hold pages seen once/twice, B1/B2 their ghosts; ghost hits move
+// the T1 target p.
+class ArcState final : public AlgoKernel<ArcState> {
+    enum ListId : char { T1, T2, B1, B2 };
+
+    std::size_t c_;
+    std::size_t p_ = 0;
+    vector<Link> links_;
+    IndexList lists_[4];
+    vector<int> nodePage_;
+    vector<ListId> nodeList_;
+    vector<std::size_t> freeNodes_;
+    PageMap directory_; // page -> node, for resident and ghost pages
+
+    std::size_t ghostHits_[2] = {0, 0};
+    std::size_t minP_         = 0;
+    std::size_t maxP_         = 0;
+    vector<pair<int, std::size_t>> timeline_; // (step, p) at evenly spaced steps
+
+    void moveTo(std::size_t node, ListId list) {
+        lists_[nodeList_[node]].remove(links_, node);
+        lists_[list].pushFront(links_, node);
+        nodeList_[node] = list;
+    }
+
+    void dropLru(ListId list) {
+        const std::size_t node = lists_[list].back();
+        lists_[list].remove(links_, node);
+        directory_.erase(nodePage_[node]);
+        freeNodes_.push_back(node);
+    }
 
-    AccessRes access(int /*step*/, int page, vector<Frame>& frames, const vector<int>& /*ref*/) override {
-        for (const auto& [p, valid] : frames) {
-            if (valid && p == page) {
-                return {true, -1};
+    bool replacesFromT1(bool hitInB2) const {
+        const std::size_t t1 = lists_[T1].size();
+        return t1 > 0 && ((hitInB2 && t1 == p_) || t1 > p_);
+    }
+
+    // Demotes the LRU page of T1 or T2 to its ghost list and returns the frame it occupied.
+    std::size_t replace(bool hitInB2) {
+        const bool fromT1      = replacesFromT1(hitInB2);
+        const std::size_t node = lists_[fromT1 ? T1 : T2].back();
+        moveTo(node, fromT1 ? B1 : B2);
+        return resident_.find(nodePage_[node]);
+    }
+
+    std::size_t reclaim(bool hitInB2) {
+        return resident_.hasFree() ? resident_.takeFree() : replace(hitInB2);
+    }
+
+    // Makes room for a page in no list, adds it to T1 and returns the frame it gets.
+    std::size_t admit(int page) {
+        const std::size_t l1    = lists_[T1].size() + lists_[B1].size();
+        const std::size_t total = l1 + lists_[T2].size() + lists_[B2].size();
+        std::size_t frame;
+        if (l1 == c_) {
+            if (lists_[T1].size() < c_) {
+                dropLru(B1);
+                frame = reclaim(false);
+            } else {
+                frame = resident_.find(nodePage_[lists_[T1].back()]);
+                dropLru(T1);
             }
+        } else if (total >= c_) {
+            if (total == 2 * c_) dropLru(B2);
+            frame = reclaim(false);
+        } else {
+            frame = resident_.takeFree();
+        }
+
+        const std::size_t fresh = freeNodes_.back();
+        freeNodes_.pop_back();
+        nodePage_[fresh] = page;
+        nodeList_[fresh] = T1;
+        lists_[T1].pushFront(links_, fresh);
+        directory_.assign(page, fresh);
+        return frame;
+    }
+
+    void adapt(std::size_t p) {
+        p_    = p;
+        minP_ = min(minP_, p_);
+        maxP_ = max(maxP_, p_);
+    }
+
+public:
+    explicit ArcState(int frameCount)
+        : AlgoKernel(frameCount), c_(frameCount), links_(2 * c_), nodePage_(2 * c_), nodeList_(2 * c_, T1),
+          directory_(2 * c_) {
+        for (std::size_t i = 2 * c_; i-- > 0;) {
+            freeNodes_.push_back(i);
+        }
+    }
+
+    AccessRes access(int step, int page, vector<Frame>& frames, span<const int> ref) override {
+        if (static_cast<std::size_t>(step) % max<std::size_t>(traceLength(ref) / 20, 1) == 0) {
+            timeline_.emplace_back(step, p_);
         }
 
-        for (std::size_t i = 0; i < frames.size(); ++i) {
-            if (!frames[i].valid) {
-                frames[i].page  = page;
-                frames[i].valid = true;
-                return {false, i};
+        const std::size_t node = directory_.find(page);
+        std::size_t frame;
+        if (node != noIndex && (nodeList_[node] == T1 || nodeList_[node] == T2)) {
+            moveTo(node, T2);
+            return {true, -1};
+        }
+
+        if (node != noIndex) {
+            // Ghost hit: the page was evicted too early from its list, so give that list more room.
+            const bool inB2           = nodeList_[node] == B2;
+            const std::size_t grown   = lists_[inB2 ? B2 : B1].size();
+            const std::size_t other   = lists_[inB2 ? B1 : B2].size();
+            const std::size_t delta   = max<std::size_t>(other / grown, 1);
+            ++ghostHits_[inB2];
+            adapt(inB2 ? (p_ > delta ? p_ - delta : 0) : min(c_, p_ + delta));
+            frame = reclaim(inB2);
+            moveTo(node, T2);
+        } else {
+            frame = admit(page);
+        }
+
+        resident_.install(frames, frame, page);
+        return {false, frame};
+    }
+
+    // A prefetched page joins T1 as a first reference would, but a ghost entry for it is only
+    // forgotten: it is no evidence that its list was too short, so p stays put.
+    std::size_t insertPrefetched(int /*step*/, int page, std::size_t keep, vector<Frame>& frames) override {
+        if (!resident_.hasFree()) {
+            const bool fromT1 = lists_[T1].size() == c_ || replacesFromT1(false);
+            if (resident_.find(nodePage_[lists_[fromT1 ? T1 : T2].back()]) == keep) return noIndex;
+        }
+        if (const std::size_t ghost = directory_.find(page); ghost != noIndex) {
+            lists_[nodeList_[ghost]].remove(links_, ghost);
+            directory_.erase(page);
+            freeNodes_.push_back(ghost);
+        }
+        const std::size_t frame = admit(page);
+        resident_.install(frames, frame, page);
+        return frame;
+    }
+
+    void printStats(ostream& os) const override {
+        os << "ARC target p (T1 share of " << c_ << " frames): min " << minP_ << ", max " << maxP_
+                << ", final " << p_ << "; ghost hits B1 " << ghostHits_[0] << ", B2 " << ghostHits_[1] << "\n";
+        os << "p over the trace:";
+        for (const auto& [step, p] : timeline_) {
+            os << " " << step << ":" << p;
+        }
+        os << "\n";
+    }
+};
+
+// LIRS (Jiang & Zhang): the bottom of stack S is always LIR; queue Q holds the resident HIR pages.
+class LirsState final : public AlgoKernel<LirsState> {
+    enum Status : char { Lir, HirResident, HirGhost };
+
+    std::size_t lirLimit_;
+    std::size_t ghostLimit_;
+    std::size_t lirCount_ = 0;
+    vector<Link> stackLinks_;
+    vector<Link> queueLinks_;
+    vector<Link> ghostLinks_;
+    IndexList stack_;  // S, front = most recent
+    IndexList queue_;  // Q, resident HIR pages, back = next victim
+    IndexList ghosts_; // non-resident HIR pages in S, back = evicted longest ago
+    vector<int> nodePage_;
+    vector<Status> nodeStatus_;
+    vector<char> inStack_;
+    vector<std::size_t> freeNodes_;
+    PageMap directory_; // page -> node for every page in S or Q
+
+    std::size_t promotions_   = 0;
+    std::size_t ghostsCapped_ = 0;
+
+    std::size_t newNode(int page) {
+        const std::size_t node = freeNodes_.back();
+        freeNodes_.pop_back();
+        nodePage_[node] = page;
+        inStack_[node]  = 0;
+        directory_.assign(page, node);
+        return node;
+    }
+
+    void deleteNode(std::size_t node) {
+        if (inStack_[node]) stack_.remove(stackLinks_, node);
+        if (nodeStatus_[node] == HirGhost) ghosts_.remove(ghostLinks_, node);
+        directory_.erase(nodePage_[node]);
+        freeNodes_.push_back(node);
+    }
+
+    void toStackTop(std::size_t node) {
+        if (inStack_[node]) stack_.moveToFront(stackLinks_, node);
+        else stack_.pushFront(stackLinks_, node);
+        inStack_[node] = 1;
+    }
+
+    // Removes HIR entries from the bottom of S until an LIR page is there.
+    void prune() {
+        while (!stack_.empty() && nodeStatus_[stack_.back()] != Lir) {
+            const std::size_t node = stack_.back();
+            if (nodeStatus_[node] == HirGhost) {
+                deleteNode(node);
+            } else {
+                stack_.remove(stackLinks_, node);
+                inStack_[node] = 0;
+            }
+        }
+    }
+
+    // The LIR page at the bottom of S becomes a resident HIR page at the tail of Q.
+    void demoteBottomLir() {
+        const std::size_t node = stack_.back();
+        stack_.remove(stackLinks_, node);
+        inStack_[node]    = 0;
+        nodeStatus_[node] = HirResident;
+        queue_.pushFront(queueLinks_, node);
+        --lirCount_;
+        prune();
+    }
+
+    void makeLir(std::size_t node) {
+        if (nodeStatus_[node] == HirResident) queue_.remove(queueLinks_, node);
+        if (nodeStatus_[node] == HirGhost) ghosts_.remove(ghostLinks_, node);
+        nodeStatus_[node] = Lir;
+        toStackTop(node);
+        ++promotions_;
+        if (++lirCount_ > lirLimit_) demoteBottomLir();
+    }
+
+    // Evicts the resident HIR page at the front of Q and returns its frame.
+    std::size_t evict() {
+        if (queue_.empty()) demoteBottomLir();
+        const std::size_t node  = queue_.back();
+        const std::size_t frame = resident_.find(nodePage_[node]);
+        queue_.remove(queueLinks_, node);
+        if (!inStack_[node]) {
+            deleteNode(node);
+            return frame;
+        }
+
+        nodeStatus_[node] = HirGhost;
+        ghosts_.pushFront(ghostLinks_, node);
+        if (ghosts_.size() > ghostLimit_) {
+            deleteNode(ghosts_.back());
+            ++ghostsCapped_;
+        }
+        return frame;
+    }
+
+public:
+    LirsState(int frameCount, std::size_t ghostLimit)
+        : AlgoKernel(frameCount),
+          lirLimit_(max<std::size_t>(frameCount - max(frameCount / 100, 1), 1)),
+          ghostLimit_(ghostLimit ? ghostLimit : 2 * static_cast<std::size_t>(frameCount)),
+          stackLinks_(frameCount + ghostLimit_ + 1), queueLinks_(stackLinks_.size()), ghostLinks_(stackLinks_.size()),
+          nodePage_(stackLinks_.size()), nodeStatus_(stackLinks_.size(), Lir), inStack_(stackLinks_.size(), 0),
+          directory_(stackLinks_.size()) {
+        for (std::size_t i = stackLinks_.size(); i-- > 0;) {
+            freeNodes_.push_back(i);
+        }
+    }
+
+    AccessRes access(int /*step*/, int page, vector<Frame>& frames, span<const int> /*ref*/) override {
+        std::size_t node = directory_.find(page);
+        if (node != noIndex && nodeStatus_[node] != HirGhost) {
+            if (nodeStatus_[node] == Lir) {
+                const bool wasBottom = stack_.back() == node;
+                toStackTop(node);
+                if (wasBottom) prune();
+            } else if (inStack_[node]) {
+                makeLir(node);
+            } else {
+                toStackTop(node);
+                queue_.moveToFront(queueLinks_, node);
+            }
+            return {true, -1};
+        }
+
+        const std::size_t frame = resident_.hasFree() ? resident_.takeFree() : evict();
+        // evict() may have dropped this page's ghost entry to honour the cap.
+        node = directory_.find(page);
+        if (node == noIndex) {
+            node = newNode(page);
+            if (lirCount_ < lirLimit_) {
+                nodeStatus_[node] = Lir;
+                ++lirCount_;
+                toStackTop(node);
+            } else {
+                nodeStatus_[node] = HirResident;
+                toStackTop(node);
+                queue_.pushFront(queueLinks_, node);
+            }
+        } else {
+            makeLir(node);
+        }
+
+        resident_.install(frames, frame, page);
+        return {false, frame};
+    }
+
+    // A prefetched page has no reuse distance yet: it becomes resident HIR at the front of Q and
+    // stays out of S, and a ghost entry for it is forgotten rather than promoted.
+    std::size_t insertPrefetched(int /*step*/, int page, std::size_t keep, vector<Frame>& frames) override {
+        if (!resident_.hasFree()) {
+            const std::size_t next = queue_.empty() ? stack_.back() : queue_.back();
+            if (resident_.find(nodePage_[next]) == keep) return noIndex;
+        }
+        if (const std::size_t ghost = directory_.find(page); ghost != noIndex) deleteNode(ghost);
+        const std::size_t frame = resident_.hasFree() ? resident_.takeFree() : evict();
+        const std::size_t node  = newNode(page);
+        nodeStatus_[node]       = HirResident;
+        queue_.pushFront(queueLinks_, node);
+        resident_.install(frames, frame, page);
+        return frame;
+    }
+
+    void printStats(ostream& os) const override {
+        os << "LIRS: " << lirCount_ << " LIR of " << lirLimit_ << ", " << queue_.size() << " resident HIR, "
+                << ghosts_.size() << " non-resident HIR (cap " << ghostLimit_ << ", " << ghostsCapped_
+                << " dropped by the cap); " << promotions_ << " HIR -> LIR promotions\n";
+    }
+};
+
+// Full 2Q (Johnson & Shasha): FIFO A1in, ghost FIFO A1out, LRU Am.
+class TwoQState final : public AlgoKernel<TwoQState> {
+    enum ListId : char { A1in, A1out, Am };
+
+    std::size_t inLimit_;
+    std::size_t outLimit_;
+    vector<Link> links_;
+    IndexList lists_[3];
+    vector<int> nodePage_;
+    vector<ListId> nodeList_;
+    vector<std::size_t> freeNodes_;
+    PageMap directory_;
+
+    // Frees a frame, evicting from A1in while it is over its share and from Am otherwise.
+    std::size_t reclaim() {
+        if (resident_.hasFree()) return resident_.takeFree();
+
+        const bool fromIn       = lists_[A1in].size() > inLimit_ || lists_[Am].empty();
+        const std::size_t node  = lists_[fromIn ? A1in : Am].back();
+        const std::size_t frame = resident_.find(nodePage_[node]);
+        lists_[nodeList_[node]].remove(links_, node);
+        if (!fromIn) {
+            directory_.erase(nodePage_[node]);
+            freeNodes_.push_back(node);
+            return frame;
+        }
+
+        nodeList_[node] = A1out;
+        lists_[A1out].pushFront(links_, node);
+        if (lists_[A1out].size() > outLimit_) {
+            const std::size_t oldest = lists_[A1out].back();
+            lists_[A1out].remove(links_, oldest);
+            directory_.erase(nodePage_[oldest]);
+            freeNodes_.push_back(oldest);
+        }
+        return frame;
+    }
+
+public:
+    explicit TwoQState(int frameCount)
+        : AlgoKernel(frameCount), inLimit_(max(frameCount / 4, 1)), outLimit_(max(frameCount / 2, 1)),
+          links_(frameCount + outLimit_ + 1), nodePage_(links_.size()), nodeList_(links_.size(), A1in),
+          directory_(links_.size()) {
+        for (std::size_t i = links_.size(); i-- > 0;) {
+            freeNodes_.push_back(i);
+        }
+    }
+
+    AccessRes access(int /*step*/, int page, vector<Frame>& frames, span<const int> /*ref*/) override {
+        std::size_t node = directory_.find(page);
+        if (node != noIndex && nodeList_[node] != A1out) {
+            if (nodeList_[node] == Am) lists_[Am].moveToFront(links_, node);
+            return {true, -1};
+        }
+
+        if (node != noIndex) {
+            // Take the ghost out first so reclaim() cannot age it out of A1out.
+            lists_[A1out].remove(links_, node);
+            nodeList_[node] = Am;
+        } else {
+            node = freeNodes_.back();
+            freeNodes_.pop_back();
+            nodePage_[node] = page;
+            nodeList_[node] = A1in;
+            directory_.assign(page, node);
+        }
+
+        const std::size_t frame = reclaim();
+        lists_[nodeList_[node]].pushFront(links_, node);
+        resident_.install(frames, frame, page);
+        return {false, frame};
+    }
+
+    // A prefetched page enters A1in; an A1out entry for it is reused but does not promote it to Am.
+    std::size_t insertPrefetched(int /*step*/, int page, std::size_t keep, vector<Frame>& frames) override {
+        if (!resident_.hasFree()) {
+            const bool fromIn = lists_[A1in].size() > inLimit_ || lists_[Am].empty();
+            if (resident_.find(nodePage_[lists_[fromIn ? A1in : Am].back()]) == keep) return noIndex;
+        }
+        std::size_t node = directory_.find(page);
+        if (node != noIndex) {
+            lists_[A1out].remove(links_, node);
+        } else {
+            node = freeNodes_.back();
+            freeNodes_.pop_back();
+            nodePage_[node] = page;
+            directory_.assign(page, node);
+        }
+        nodeList_[node] = A1in;
+
+        const std::size_t frame = reclaim();
+        lists_[A1in].pushFront(links_, node);
+        resident_.install(frames, frame, page);
+        return frame;
+    }
+};
+
+// Linux-style active/inactive lists with shadow entries for refault distance (mm/workingset.c).
+class LinuxState final : public AlgoKernel<LinuxState> {
+    enum ListId : char { Inactive, Active, Shadow };
+
+    std::size_t shadowLimit_;
+    vector<Link> links_;
+    IndexList lists_[3];
+    vector<int> nodePage_;
+    vector<ListId> nodeList_;
+    vector<char> referenced_;
+    vector<std::size_t> evictedAt_;
+    vector<std::size_t> freeNodes_;
+    PageMap directory_;
+    std::size_t clock_ = 0; // evictions and activations so far, like nonresident_age
+
+    std::size_t promotions_  = 0;
+    std::size_t refaults_    = 0;
+    std::size_t activations_ = 0; // refaults activated directly
+
+    void moveTo(std::size_t node, ListId list) {
+        lists_[nodeList_[node]].remove(links_, node);
+        lists_[list].pushFront(links_, node);
+        nodeList_[node] = list;
+    }
+
+    void releaseNode(std::size_t node) {
+        lists_[nodeList_[node]].remove(links_, node);
+        directory_.erase(nodePage_[node]);
+        freeNodes_.push_back(node);
+    }
+
+    void activate(std::size_t node) {
+        moveTo(node, Active);
+        referenced_[node] = 0;
+        ++clock_;
+    }
+
+    // Moves active tail pages to the inactive list until the active list is no longer the larger.
+    void balance() {
+        while (lists_[Active].size() > lists_[Inactive].size()) {
+            const std::size_t node = lists_[Active].back();
+            if (referenced_[node]) {
+                referenced_[node] = 0;
+                lists_[Active].moveToFront(links_, node);
+            } else {
+                moveTo(node, Inactive);
+            }
+        }
+    }
+
+    std::size_t reclaim() {
+        if (resident_.hasFree()) return resident_.takeFree();
+
+        balance();
+        const std::size_t node  = lists_[Inactive].back();
+        const std::size_t frame = resident_.find(nodePage_[node]);
+        evictedAt_[node]        = clock_++;
+        moveTo(node, Shadow);
+        if (lists_[Shadow].size() > shadowLimit_) releaseNode(lists_[Shadow].back());
+        return frame;
+    }
+
+public:
+    explicit LinuxState(int frameCount)
+        : AlgoKernel(frameCount), shadowLimit_(frameCount), links_(2 * static_cast<std::size_t>(frameCount) + 1),
+          nodePage_(links_.size()), nodeList_(links_.size(), Inactive), referenced_(links_.size(), 0),
+          evictedAt_(links_.size(), 0), directory_(links_.size()) {
+        for (std::size_t i = links_.size(); i-- > 0;) {
+            freeNodes_.push_back(i);
+        }
+    }
+
+    AccessRes access(int /*step*/, int page, vector<Frame>& frames, span<const int> /*ref*/) override {
+        std::size_t node = directory_.find(page);
+        if (node != noIndex && nodeList_[node] != Shadow) {
+            if (nodeList_[node] == Inactive && referenced_[node]) {
+                activate(node);
+                ++promotions_;
+            } else {
+                referenced_[node] = 1;
+            }
+            return {true, -1};
+        }
+
+        bool refault = false;
+        if (node != noIndex) {
+            // Detach the shadow before reclaiming so it cannot be aged out meanwhile.
+            lists_[Shadow].remove(links_, node);
+            ++refaults_;
+            refault = clock_ - evictedAt_[node] <= lists_[Active].size();
+        } else {
+            node = freeNodes_.back();
+            freeNodes_.pop_back();
+            nodePage_[node] = page;
+            directory_.assign(page, node);
+        }
+
+        const std::size_t frame = reclaim();
+        nodeList_[node]         = Inactive;
+        referenced_[node]       = 1;
+        lists_[Inactive].pushFront(links_, node);
+        if (refault) {
+            activate(node);
+            ++activations_;
+        }
+        resident_.install(frames, frame, page);
+        return {false, frame};
+    }
+
+    // Readahead pages go to the inactive head unreferenced, so one real use only marks them; a
+    // shadow entry for the page is dropped without being taken as a refault.
+    std::size_t insertPrefetched(int /*step*/, int page, std::size_t keep, vector<Frame>& frames) override {
+        if (!resident_.hasFree()) {
+            balance();
+            if (resident_.find(nodePage_[lists_[Inactive].back()]) == keep) return noIndex;
+        }
+        std::size_t node = directory_.find(page);
+        if (node != noIndex) {
+            lists_[Shadow].remove(links_, node);
+        } else {
+            node = freeNodes_.back();
+            freeNodes_.pop_back();
+            nodePage_[node] = page;
+            directory_.assign(page, node);
+        }
+
+        const std::size_t frame = reclaim();
+        nodeList_[node]         = Inactive;
+        referenced_[node]       = 0;
+        lists_[Inactive].pushFront(links_, node);
+        resident_.install(frames, frame, page);
+        return frame;
+    }
+
+    void printStats(ostream& os) const override {
+        os << "Linux two-list: " << lists_[Active].size() << " active, " << lists_[Inactive].size()
+                << " inactive, " << lists_[Shadow].size() << " shadow entries; " << promotions_
+                << " promotions on second reference, " << refaults_ << " refaults, " << activations_
+                << " activated by refault distance\n";
+    }
+};
+
+// O(1) LFU (Shah, Mitra & Matani): frames hang off use-count buckets kept in ascending order.
+class LfuState final : public AlgoKernel<LfuState> {
+    std::size_t halveEvery_;
+    std::size_t accesses_ = 0;
+    std::size_t halvings_ = 0;
+    vector<Link> frameLinks_;
+    vector<std::size_t> frameBucket_;
+    vector<Link> bucketLinks_;
+    IndexList buckets_; // ascending count
+    vector<std::size_t> bucketCount_;
+    vector<IndexList> bucketFrames_; // front = most recently used
+    vector<std::size_t> freeBuckets_;
+    vector<pair<std::size_t, std::size_t>> scratch_; // (frame, count) while halving
+
+    // The bucket for `count` right after `prev` (or first if prev is noIndex), created if missing.
+    std::size_t bucketAfter(std::size_t prev, std::size_t count) {
+        const std::size_t next = prev == noIndex ? buckets_.front() : bucketLinks_[prev].next;
+        if (next != noIndex && bucketCount_[next] == count) return next;
+
+        const std::size_t bucket = freeBuckets_.back();
+        freeBuckets_.pop_back();
+        bucketCount_[bucket] = count;
+        if (prev == noIndex) buckets_.pushFront(bucketLinks_, bucket);
+        else buckets_.insertAfter(bucketLinks_, prev, bucket);
+        return bucket;
+    }
+
+    void place(std::size_t frame, std::size_t bucket) {
+        bucketFrames_[bucket].pushFront(frameLinks_, frame);
+        frameBucket_[frame] = bucket;
+    }
+
+    void unplace(std::size_t frame) {
+        const std::size_t bucket = frameBucket_[frame];
+        bucketFrames_[bucket].remove(frameLinks_, frame);
+        if (bucketFrames_[bucket].empty()) {
+            buckets_.remove(bucketLinks_, bucket);
+            freeBuckets_.push_back(bucket);
+        }
+    }
+
+    void halve() {
+        scratch_.clear();
+        for (std::size_t b = buckets_.front(); b != noIndex; b = bucketLinks_[b].next) {
+            for (std::size_t f = bucketFrames_[b].back(); f != noIndex; f = frameLinks_[f].prev) {
+                scratch_.emplace_back(f, bucketCount_[b]);
+            }
+        }
+        for (const auto& [frame, count] : scratch_) {
+            unplace(frame);
+        }
+        // Counts stay in ascending order after halving, so frames only ever join the last bucket.
+        for (const auto& [frame, count] : scratch_) {
+            const std::size_t halved = count ? max<std::size_t>(count >> 1, 1) : 0;
+            const std::size_t last   = buckets_.back();
+            place(frame, last != noIndex && bucketCount_[last] == halved ? last : bucketAfter(last, halved));
+        }
+        ++halvings_;
+    }
+
+public:
+    LfuState(int frameCount, std::size_t halveEvery)
+        : AlgoKernel(frameCount), halveEvery_(halveEvery), frameLinks_(frameCount), frameBucket_(frameCount, noIndex),
+          bucketLinks_(frameCount + 1), bucketCount_(frameCount + 1, 0), bucketFrames_(frameCount + 1) {
+        for (std::size_t i = bucketLinks_.size(); i-- > 0;) {
+            freeBuckets_.push_back(i);
+        }
+    }
+
+    AccessRes access(int /*step*/, int page, vector<Frame>& frames, span<const int> /*ref*/) override {
+        if (halveEvery_ && ++accesses_ % halveEvery_ == 0) halve();
+
+        if (const std::size_t frame = resident_.find(page); frame != noIndex) {
+            const std::size_t bucket = frameBucket_[frame];
+            const std::size_t next   = bucketAfter(bucket, bucketCount_[bucket] + 1);
+            unplace(frame);
+            place(frame, next);
+            return {true, -1};
+        }
+
+        std::size_t victim;
+        if (resident_.hasFree()) {
+            victim = resident_.takeFree();
+        } else {
+            victim = bucketFrames_[buckets_.front()].back();
+            unplace(victim);
+        }
+
+        // Prefetched pages not yet used sit in a count-0 bucket ahead of the count-1 one.
+        const std::size_t first = buckets_.front();
+        resident_.install(frames, victim, page);
+        place(victim, bucketAfter(first != noIndex && bucketCount_[first] == 0 ? first : noIndex, 1));
+        return {false, victim};
+    }
+
+    // A prefetched page starts at count 0 and is not an access, so it does not bring halving nearer.
+    std::size_t insertPrefetched(int /*step*/, int page, std::size_t keep, vector<Frame>& frames) override {
+        std::size_t victim;
+        if (resident_.hasFree()) {
+            victim = resident_.takeFree();
+        } else {
+            victim = bucketFrames_[buckets_.front()].back();
+            if (victim == keep) return noIndex;
+            unplace(victim);
+        }
+
+        resident_.install(frames, victim, page);
+        place(victim, bucketAfter(noIndex, 0));
+        return victim;
+    }
+
+    void printStats(ostream& os) const override {
+        os << "LFU: " << buckets_.size() << " count buckets, highest count "
+                << (buckets_.empty() ? 0 : bucketCount_[buckets_.back()]) << ", counts halved " << halvings_
+                << " times\n";
+    }
+};
+
+// Size of the working set W(t, tau): the distinct pages among the last tau references. Each
+// reference adds its page and retires the one made tau steps earlier, if that was its page's
+// latest use, so an update is O(1) amortized with O(tau + distinct pages) memory.
+class WorkingSetTracker {
+    std::size_t tau_;
+    std::size_t time_ = 0;
+    std::size_t size_ = 0;
+    vector<int> window_; // ring of the last tau pages
+    unordered_map<int, std::size_t> lastUse_;
+
+public:
+    explicit WorkingSetTracker(std::size_t tau) : tau_(max<std::size_t>(tau, 1)), window_(tau_) {}
+
+    std::size_t size() const { return size_; }
+
+    void add(int page) {
+        const std::size_t slot = time_ % tau_;
+        if (time_ >= tau_ && lastUse_[window_[slot]] == time_ - tau_) --size_;
+
+        auto [it, fresh] = lastUse_.try_emplace(page, time_);
+        if (fresh || it->second + tau_ <= time_) ++size_;
+        it->second    = time_;
+        window_[slot] = page;
+        ++time_;
+    }
+};
+
+// Keeps min/max/mean of a series and about `points` evenly spaced samples of it.
+class SeriesSampler {
+    std::size_t every_;
+    std::size_t count_ = 0;
+    std::size_t min_   = 0;
+    std::size_t max_   = 0;
+    double sum_        = 0;
+    vector<pair<std::size_t, std::size_t>> samples_;
+
+public:
+    SeriesSampler(std::size_t length, std::size_t points) : every_(max<std::size_t>(length / points, 1)) {}
+
+    void add(std::size_t value) {
+        min_ = count_ ? min(min_, value) : value;
+        max_ = max(max_, value);
+        sum_ += static_cast<double>(value);
+        if (count_ % every_ == 0) samples_.emplace_back(count_, value);
+        ++count_;
+    }
+
+    void print(ostream& os) const {
+        os << "min " << min_ << ", mean " << (count_ ? sum_ / count_ : 0.0) << ", max " << max_ << "\n";
+        for (const auto& [step, value] : samples_) {
+            os << " " << step << ":" << value;
+        }
+        os << "\n";
+    }
+};
+
+// WSClock (Carr & Hennessy) in virtual time: pages unused for more than tau references may go.
+class WsClockState final : public AlgoKernel<WsClockState> {
+    std::size_t tau_;
+    vector<char> referenced_;
+    vector<std::size_t> lastUse_;
+    std::size_t hand_ = 0;
+    WorkingSetTracker workingSet_;
+    unique_ptr<SeriesSampler> sizes_;
+
+    std::size_t oldEvictions_      = 0;
+    std::size_t fallbackEvictions_ = 0;
+
+    // One turn of the hand for a victim other than frame `keep`; noIndex if keep is the only frame.
+    std::size_t sweep(std::size_t now, vector<Frame>& frames, std::size_t keep = noIndex) {
+        std::size_t oldest = noIndex;
+        for (std::size_t scanned = 0; scanned < frames.size(); ++scanned) {
+            const std::size_t f = hand_;
+            hand_               = (hand_ + 1) % frames.size();
+            if (referenced_[f]) {
+                referenced_[f] = 0;
+                lastUse_[f]    = now;
+            } else if (f != keep && now - lastUse_[f] > tau_) {
+                if (!frames[f].dirty) {
+                    ++oldEvictions_;
+                    return f;
+                }
+                resident_.clean(frames, f);
+            }
+            if (f != keep && (oldest == noIndex || lastUse_[f] < lastUse_[oldest])) oldest = f;
+        }
+        if (oldest == noIndex) return noIndex;
+        ++fallbackEvictions_;
+        hand_ = (oldest + 1) % frames.size();
+        return oldest;
+    }
+
+public:
+    WsClockState(int frameCount, std::size_t tau)
+        : AlgoKernel(frameCount), tau_(tau ? tau : static_cast<std::size_t>(frameCount)),
+          referenced_(frameCount, 0), lastUse_(frameCount, 0), workingSet_(tau_) {}
+
+    AccessRes access(int step, int page, vector<Frame>& frames, span<const int> ref) override {
+        if (!sizes_) sizes_ = make_unique<SeriesSampler>(traceLength(ref), 20);
+        workingSet_.add(page);
+        sizes_->add(workingSet_.size());
+
+        const auto now = static_cast<std::size_t>(step);
+        if (const std::size_t frame = resident_.find(page); frame != noIndex) {
+            referenced_[frame] = 1;
+            return {true, -1};
+        }
+
+        const std::size_t victim = resident_.hasFree() ? resident_.takeFree() : sweep(now, frames);
+        resident_.install(frames, victim, page);
+        referenced_[victim] = 1;
+        lastUse_[victim]    = now;
+        return {false, victim};
+    }
+
+    // A prefetch is not a reference, so it leaves the working-set tracker alone; the page is
+    // stamped with its load time but its reference bit stays clear.
+    std::size_t insertPrefetched(int step, int page, std::size_t keep, vector<Frame>& frames) override {
+        const auto now           = static_cast<std::size_t>(step);
+        const std::size_t victim = resident_.hasFree() ? resident_.takeFree() : sweep(now, frames, keep);
+        if (victim == noIndex) return noIndex;
+        resident_.install(frames, victim, page);
+        referenced_[victim] = 0;
+        lastUse_[victim]    = now;
+        return victim;
+    }
+
+    void printStats(ostream& os) const override {
+        os << "WSClock (tau " << tau_ << "): " << oldEvictions_ << " evictions outside the working set, "
+                << fallbackEvictions_ << " of the oldest page when none was\n";
+        if (sizes_) {
+            os << "Working-set size: ";
+            sizes_->print(os);
+        }
+    }
+};
+
+// Aging (NFU with a shift register): the frame with the smallest counter is the victim.
+template <typename Counter>
+class AgingState final : public AlgoKernel<AgingState<Counter>> {
+    using AlgoKernel<AgingState>::resident_;
+
+    static constexpr Counter topBit = static_cast<Counter>(Counter{1} << (8 * sizeof(Counter) - 1));
+
+    std::size_t interval_;
+    std::size_t accesses_ = 0;
+    std::size_t ticks_    = 0;
+    vector<Counter> counters_;
+    vector<uint8_t> referenced_;
+
+    void tick() {
+        for (std::size_t i = 0; i < counters_.size(); ++i) {
+            counters_[i]    = static_cast<Counter>((counters_[i] >> 1) | (referenced_[i] ? topBit : 0));
+            referenced_[i] = 0;
+        }
+        ++ticks_;
+    }
+
+public:
+    AgingState(int frameCount, std::size_t interval)
+        : AlgoKernel<AgingState>(frameCount), interval_(interval ? interval : static_cast<std::size_t>(frameCount)),
+          counters_(frameCount, 0), referenced_(frameCount, 0) {}
+
+    AccessRes access(int /*step*/, int page, vector<Frame>& frames, span<const int> /*ref*/) override {
+        if (++accesses_ % interval_ == 0) tick();
+
+        if (const std::size_t frame = resident_.find(page); frame != noIndex) {
+            referenced_[frame] = 1;
+            return {true, -1};
+        }
+
+        const std::size_t victim = resident_.hasFree()
+                                       ? resident_.takeFree()
+                                       : simd::minIndex(counters_.data(), counters_.size());
+        // The reference that caused the fault sets R, so the next tick ranks the page with the hits.
+        resident_.install(frames, victim, page);
+        counters_[victim]   = 0;
+        referenced_[victim] = 1;
+        return {false, victim};
+    }
+
+    // A prefetched page starts with an empty history and does not count towards the next tick.
+    std::size_t insertPrefetched(int /*step*/, int page, std::size_t keep, vector<Frame>& frames) override {
+        std::size_t victim;
+        if (resident_.hasFree()) {
+            victim = resident_.takeFree();
+        } else {
+            // Hide the frame to keep from the scan behind the largest counter.
+            const Counter kept = counters_[keep];
+            counters_[keep]    = numeric_limits<Counter>::max();
+            victim             = simd::minIndex(counters_.data(), counters_.size());
+            counters_[keep]    = kept;
+            if (victim == keep) return noIndex;
+        }
+        resident_.install(frames, victim, page);
+        counters_[victim]   = 0;
+        referenced_[victim] = 0;
+        return victim;
+    }
+
+    void printStats(ostream& os) const override {
+        os << "Aging: " << 8 * sizeof(Counter) << "-bit counters, tick every " << interval_ << " references, "
+                << ticks_ << " ticks\n";
+    }
+};
+
+// Tunables for the policies that have them; zero picks a default from the frame count.
+struct PolicyConfig {
+    std::size_t lirsGhosts    = 0; // cap on LIRS non-resident HIR entries, default 2 x frames
+    std::size_t lfuHalveEvery = 0; // halve LFU counts after this many references, 0 = never
+    std::size_t wsWindow      = 0; // WSClock working-set window tau in references, default frames
+    std::size_t agingInterval = 0; // references between aging ticks, default frames
+    int agingBits             = 8; // aging counter width: 8, 16 or 32
+};
+
+unique_ptr<AlgoState> newAlgoState(ReplaceAlgo algo, int frameCount, const PolicyConfig& config = {}) {
+    switch (algo) {
+        case ReplaceAlgo::Fifo_algo:
+            return newSizedState<FixedFifoState, FifoState>(frameCount);
+        case ReplaceAlgo::Opt_algo:
+            return make_unique<OptState>(frameCount);
+        case ReplaceAlgo::Lru_algo:
+            return newSizedState<FixedLruState, LruState>(frameCount);
+        case ReplaceAlgo::Clock_algo:
+            return newSizedState<FixedClockState, ClockState>(frameCount);
+        case ReplaceAlgo::Esc_algo:
+            return make_unique<EscState>(frameCount);
+        case ReplaceAlgo::Arc_algo:
+            return make_unique<ArcState>(frameCount);
+        case ReplaceAlgo::Lirs_algo:
+            return make_unique<LirsState>(frameCount, config.lirsGhosts);
+        case ReplaceAlgo::TwoQ_algo:
+            return make_unique<TwoQState>(frameCount);
+        case ReplaceAlgo::Linux_algo:
+            return make_unique<LinuxState>(frameCount);
+        case ReplaceAlgo::Lfu_algo:
+            return make_unique<LfuState>(frameCount, config.lfuHalveEvery);
+        case ReplaceAlgo::WsClock_algo:
+            return make_unique<WsClockState>(frameCount, config.wsWindow);
+        case ReplaceAlgo::Aging_algo:
+            if (config.agingBits == 32) return make_unique<AgingState<uint32_t>>(frameCount, config.agingInterval);
+            if (config.agingBits == 16) return make_unique<AgingState<uint16_t>>(frameCount, config.agingInterval);
+            return make_unique<AgingState<uint8_t>>(frameCount, config.agingInterval);
+        default:
+            return make_unique<FifoState>(frameCount);
+    }
+}
+
+struct StepResult {
+    int step;
+    int page;
+    bool hit;
+    std::size_t victim;
+    vector<Frame> frames;
+};
+
+// `writes` is empty for a read-only trace, otherwise writes[i] != 0 marks ref[i] as a write.
+vector<StepResult> simulate(AlgoState& state, int frameCount, span<const int> ref, span<const uint8_t> writes) {
+    vector<Frame> frames(frameCount);
+    vector<StepResult> results;
+    results.reserve(ref.size());
+
+    for (std::size_t step = 0; step < ref.size(); ++step) {
+        const bool write   = !writes.empty() && writes[step];
+        auto [hit, victim] = state.reference(static_cast<int>(step), ref[step], write, frames, ref);
+        results.push_back(StepResult{static_cast<int>(step), ref[step], hit, victim, frames,});
+    }
+
+    return results;
+}
+
+vector<StepResult> simulate(ReplaceAlgo algo, int frameCount, span<const int> ref) {
+    const auto state = newAlgoState(algo, frameCount);
+    return simulate(*state, frameCount, ref, {});
+}
+
+struct SimSummary {
+    std::size_t references = 0;
+    std::size_t writes     = 0;
+    std::size_t hits       = 0;
+    std::size_t faults     = 0;
+    std::size_t evictions  = 0;
+    std::size_t writeBacks = 0;
+    std::size_t prefetches       = 0; // pages brought in ahead of use
+    std::size_t usefulPrefetches = 0; // of those, referenced before being evicted
+    std::size_t wastedPrefetches = 0; // evicted unreferenced
+    vector<uint64_t> unreferencedPages; // page numbers behind the ids prefetching added past the trace's
+    vector<StepResult> samples;
+};
+
+enum class PrefetchKind { None, NextN, Readahead };
+
+// The page numbers behind the page ids of a trace cut from addresses (trace::pagesOf), both
+// ways; empty when the ids are the page numbers.
+struct PageNumbering {
+    span<const uint64_t> numbers; // numbers[id]
+    const unordered_map<uint64_t, int>* ids = nullptr;
+};
+
+struct PrefetchConfig {
+    PrefetchKind kind     = PrefetchKind::None;
+    std::size_t degree    = 4;  // NextN: pages after a faulting page; Readahead: initial window
+    std::size_t maxWindow = 32; // Readahead: largest window
+    PageNumbering pages{};      // what the page after a page is
+};
+
+// Decides which pages to bring in after each reference. It works on page numbers, where page + 1
+// is the next page in memory; SummaryRun maps them to and from the ids the policies see.
+class Prefetcher {
+public:
+    virtual ~Prefetcher() = default;
+    virtual void plan(uint64_t page, bool hit, vector<uint64_t>& pages) = 0;
+
+protected:
+    // Appends page + 1 .. page + count, stopping at the last page number.
+    static void appendRun(uint64_t page, std::size_t count, vector<uint64_t>& pages) {
+        for (std::size_t i = 1; i <= count && page < numeric_limits<uint64_t>::max(); ++i) pages.push_back(++page);
+    }
+};
+
+// On every fault, the next `degree` pages.
+class NextNPrefetcher final : public Prefetcher {
+    std::size_t degree_;
+
+public:
+    explicit NextNPrefetcher(std::size_t degree) : degree_(degree) {}
+
+    void plan(uint64_t page, bool hit, vector<uint64_t>& pages) override {
+        if (!hit) appendRun(page, degree_, pages);
+    }
+};
+
+// Sequential-stream detection after Linux's on-demand readahead. A fault right after the
+// previous page starts a window of `degree` pages; the first page of the window's second half is
+// a marker, and referencing it reads the next window ahead, twice as large up to maxWindow.
+// A fault anywhere else is taken as random access and ends the stream.
+class ReadaheadPrefetcher final : public Prefetcher {
+    std::size_t initial_;
+    std::size_t maxWindow_;
+    uint64_t next_       = 0; // the page after the last one referenced
+    bool hasNext_        = false;
+    uint64_t windowEnd_  = 0; // one past the last page read ahead
+    uint64_t marker_     = 0;
+    std::size_t window_  = 0; // 0 while no stream is active
+
+    void readWindow(uint64_t from, std::size_t size, vector<uint64_t>& pages) {
+        // Pages left above from, so neither end of the window wraps past the last page number.
+        const uint64_t room = numeric_limits<uint64_t>::max() - from;
+        window_             = size;
+        appendRun(from - 1, size, pages);
+        windowEnd_ = from + min<uint64_t>(size, room);
+        marker_    = from + min<uint64_t>(size / 2, room);
+    }
+
+public:
+    ReadaheadPrefetcher(std::size_t initial, std::size_t maxWindow)
+        : initial_(initial), maxWindow_(max(maxWindow, initial)) {}
+
+    void plan(uint64_t page, bool hit, vector<uint64_t>& pages) override {
+        const bool sequential = hasNext_ && page == next_;
+        hasNext_              = page < numeric_limits<uint64_t>::max();
+        next_                 = page + 1;
+        if (!hit) {
+            if (sequential && hasNext_) readWindow(next_, initial_, pages);
+            else window_ = 0;
+        } else if (window_ && page == marker_) {
+            readWindow(windowEnd_, min(2 * window_, maxWindow_), pages);
+        }
+    }
+};
+
+unique_ptr<Prefetcher> newPrefetcher(const PrefetchConfig& config) {
+    switch (config.kind) {
+        case PrefetchKind::NextN: return make_unique<NextNPrefetcher>(config.degree);
+        case PrefetchKind::Readahead: return make_unique<ReadaheadPrefetcher>(config.degree, config.maxWindow);
+        default: return nullptr;
+    }
+}
+
+// Latencies that turn the counters into an effective access time.
+struct CostModel {
+    double hitNs       = 100;    // one memory access
+    double faultNs     = 100000; // reading a page in from backing store
+    double writeBackNs = 100000; // writing a dirty page back
+};
+
+double effectiveAccessNs(const SimSummary& summary, const CostModel& cost) {
+    if (!summary.references) return 0.0;
+    return cost.hitNs + (static_cast<double>(summary.faults) * cost.faultNs
+                         + static_cast<double>(summary.writeBacks) * cost.writeBackNs) / summary.references;
+}
+
+// Counters-only simulation fed one block of references at a time, so memory stays constant in
+// the trace length. With sampleEvery > 0 the frame state after every sampleEvery-th reference is
+// kept as well.
+class SummaryRun {
+    AlgoState& state_;
+    vector<Frame> frames_;
+    SimSummary summary_;
+    std::size_t sampleEvery_;
+    unique_ptr<Prefetcher> prefetcher_;
+    vector<uint64_t> plan_;
+    PageNumbering numbering_;
+    unordered_map<uint64_t, int> unreferencedIds_; // inverse of summary_.unreferencedPages
+
+    // The page number a prefetcher plans from: the id itself, shifted to be non-negative, unless
+    // the trace was numbered from addresses.
+    uint64_t numberOf(int page) const {
+        if (numbering_.numbers.empty()) return static_cast<uint64_t>(int64_t{page} - numeric_limits<int>::min());
+        const auto id = static_cast<std::size_t>(page);
+        return id < numbering_.numbers.size() ? numbering_.numbers[id]
+                                              : summary_.unreferencedPages[id - numbering_.numbers.size()];
+    }
+
+    // The id for a planned page number. A page the trace never references gets the next unused id;
+    // false once ids would pass INT_MAX.
+    bool idOf(uint64_t number, int& page) {
+        if (numbering_.numbers.empty()) {
+            if (number > numeric_limits<uint32_t>::max()) return false;
+            page = static_cast<int>(static_cast<int64_t>(number) + numeric_limits<int>::min());
+            return true;
+        }
+        if (const auto it = numbering_.ids->find(number); it != numbering_.ids->end()) {
+            page = it->second;
+            return true;
+        }
+        auto it = unreferencedIds_.find(number);
+        if (it == unreferencedIds_.end()) {
+            const std::size_t id = numbering_.numbers.size() + summary_.unreferencedPages.size();
+            if (id > static_cast<std::size_t>(numeric_limits<int>::max())) return false;
+            it = unreferencedIds_.emplace(number, static_cast<int>(id)).first;
+            summary_.unreferencedPages.push_back(number);
+        }
+        page = it->second;
+        return true;
+    }
+
+public:
+    SummaryRun(AlgoState& state, int frameCount, std::size_t sampleEvery, const PrefetchConfig& prefetch = {})
+        : state_(state), frames_(frameCount), sampleEvery_(sampleEvery), prefetcher_(newPrefetcher(prefetch)),
+          numbering_(prefetch.pages) {}
+
+    // `ref` is the trace as the policy sees it: OPT needs the whole trace with pages/writes being
+    // its next slice; other policies are fine with just the block once given setTraceLength.
+    void feed(span<const int> pages, span<const uint8_t> writes, span<const int> ref) {
+        for (const uint8_t w : writes) summary_.writes += w != 0;
+        if (!sampleEvery_ && !prefetcher_) {
+            const std::size_t hits = state_.accessMany(static_cast<int>(summary_.references), pages, writes, frames_, ref);
+            summary_.references += pages.size();
+            summary_.hits += hits;
+            summary_.faults += pages.size() - hits;
+            return;
+        }
+        for (std::size_t i = 0; i < pages.size(); ++i) {
+            const auto step = static_cast<int>(summary_.references++);
+            if (prefetcher_) {
+                if (const std::size_t f = state_.frameOf(pages[i]); f != noIndex && frames_[f].prefetched) {
+                    frames_[f].prefetched = false;
+                    ++summary_.usefulPrefetches;
+                }
+            }
+            auto [hit, victim] = state_.reference(step, pages[i], !writes.empty() && writes[i], frames_, ref);
+            if (hit) ++summary_.hits;
+            else ++summary_.faults;
+            if (prefetcher_) {
+                plan_.clear();
+                prefetcher_->plan(numberOf(pages[i]), hit, plan_);
+                for (const uint64_t number : plan_) {
+                    if (int page; idOf(number, page)) summary_.prefetches += state_.prefetch(step, page, pages[i], frames_);
+                }
+            }
+            if (sampleEvery_ && summary_.references % sampleEvery_ == 0) {
+                summary_.samples.push_back(StepResult{step, pages[i], hit, victim, frames_,});
+            }
+        }
+    }
+
+    SimSummary finish() {
+        // Free frames are always filled before anything is evicted.
+        const std::size_t loads   = summary_.faults + summary_.prefetches;
+        summary_.evictions        = loads - min(loads, frames_.size());
+        summary_.writeBacks       = state_.writeBacks();
+        summary_.wastedPrefetches = state_.unusedPrefetches();
+        return move(summary_);
+    }
+};
+
+// OPT cannot be combined with prefetching: it plans with the trace position of the reference.
+SimSummary simulateSummary(AlgoState& state, int frameCount, span<const int> ref, span<const uint8_t> writes,
+                           std::size_t sampleEvery = 0, const PrefetchConfig& prefetch = {}) {
+    SummaryRun run(state, frameCount, sampleEvery, prefetch);
+    run.feed(ref, writes, ref);
+    return run.finish();
+}
+
+// Decodes a delta-block trace while simulating it. OPT cannot run this way as it needs the
+// whole trace up front.
+bool simulateSummary(AlgoState& state, int frameCount, const trace::BlockReader& blocks, SimSummary& summary,
+                     std::size_t sampleEvery = 0, const PrefetchConfig& prefetch = {}) {
+    state.setTraceLength(blocks.size());
+    SummaryRun run(state, frameCount, sampleEvery, prefetch);
+    vector<int> pages;
+    vector<uint8_t> writes;
+    for (std::size_t b = 0; b < blocks.blockCount(); ++b) {
+        if (!blocks.decode(b, pages, writes)) return false;
+        run.feed(pages, writes, pages);
+    }
+    summary = run.finish();
+    return true;
+}
+
+SimSummary simulateSummary(ReplaceAlgo algo, int frameCount, span<const int> ref, std::size_t sampleEvery = 0) {
+    const auto state = newAlgoState(algo, frameCount);
+    return simulateSummary(*state, frameCount, ref, {}, sampleEvery);
+}
+
+// One cache level of a memory hierarchy: how many pages it holds, how it replaces them, and the
+// cost of an access that reaches it.
+struct TierConfig {
+    ReplaceAlgo algo = ReplaceAlgo::Lru_algo;
+    int entries      = 0;
+    double ns        = 0;
+};
+
+// TLB -> RAM -> swap. Each reference looks its page up in the TLB (walkNs more on a miss) and
+// then accesses RAM; a RAM fault goes to the swap tier, and a swap miss to disk. Every tier
+// keeps its own policy state, and a page missing in a tier is filled into it. Every page RAM
+// writes back, evicted or only cleaned, is placed in swap through the swap policy.
+struct HierarchyConfig {
+    TierConfig tlb{ReplaceAlgo::Lru_algo, 64, 1};
+    double walkNs = 50;
+    TierConfig ram{ReplaceAlgo::Lru_algo, 0, 100};
+    TierConfig swap{ReplaceAlgo::Lru_algo, 0, 10000}; // entries default to 4 x RAM frames
+    double diskNs = 100000;
+};
+
+struct TierStats {
+    std::size_t accesses = 0;
+    std::size_t hits     = 0;
+};
+
+struct HierarchySummary {
+    std::size_t references = 0;
+    TierStats tlb, ram, swap;
+    std::size_t staleTlbHits = 0; // TLB hits for a page RAM no longer held, counted as misses
+    std::size_t writeBacks   = 0; // dirty RAM pages written to swap
+    double amatNs            = 0;
+};
+
+HierarchySummary simulateHierarchy(span<const int> ref, span<const uint8_t> writes, const HierarchyConfig& config,
+                                   const PolicyConfig& policy = {}) {
+    struct Tier {
+        unique_ptr<AlgoState> state;
+        vector<Frame> frames;
+        TierStats* stats;
+
+        AccessRes access(int step, int page, bool write, span<const int> ref) {
+            ++stats->accesses;
+            const AccessRes res = state->reference(step, page, write, frames, ref);
+            stats->hits += res.hit;
+            return res;
+        }
+    };
+
+    HierarchySummary summary;
+    summary.references    = ref.size();
+    const int swapEntries = config.swap.entries ? config.swap.entries : 4 * config.ram.entries;
+    Tier tlb{newAlgoState(config.tlb.algo, config.tlb.entries, policy), vector<Frame>(config.tlb.entries), &summary.tlb};
+    Tier ram{newAlgoState(config.ram.algo, config.ram.entries, policy), vector<Frame>(config.ram.entries), &summary.ram};
+    Tier swap{newAlgoState(config.swap.algo, swapEntries, policy), vector<Frame>(swapEntries), &summary.swap};
+    vector<int> written; // pages RAM wrote back during the current access
+    ram.state->recordWrittenPages(&written);
+
+    for (std::size_t t = 0; t < ref.size(); ++t) {
+        const auto step   = static_cast<int>(t);
+        const bool tlbHit = tlb.access(step, ref[t], false, ref).hit;
+        if (!ram.access(step, ref[t], !writes.empty() && writes[t], ref).hit) {
+            // The translation was for a page that has since been evicted: a page fault, not a TLB hit.
+            if (tlbHit) {
+                --summary.tlb.hits;
+                ++summary.staleTlbHits;
             }
+            swap.access(step, ref[t], false, ref);
         }
+        // Each write-back stores its page in swap, so the page's next fault can hit there; that
+        // includes pages a hand cleaned and left resident. It is not a swap-in, so it stays out of
+        // the swap tier's counts.
+        for (const int page : written) swap.state->reference(step, page, false, swap.frames, ref);
+        written.clear();
+    }
 
-        int victim           = nextIndex_;
-        nextIndex_           = (nextIndex_ + 1) % static_cast<int>(frames.size());
-        frames[victim].page  = page;
-        frames[victim].valid = true;
-        return {false, victim};
+    summary.writeBacks = ram.state->writeBacks();
+    if (summary.references) {
+        const auto n         = static_cast<double>(summary.references);
+        const double walks   = static_cast<double>(summary.tlb.accesses - summary.tlb.hits);
+        const double swapIns = static_cast<double>(summary.swap.accesses);
+        const double reads   = static_cast<double>(summary.swap.accesses - summary.swap.hits);
+        summary.amatNs = config.tlb.ns + config.ram.ns
+                         + (walks * config.walkNs + swapIns * config.swap.ns + reads * config.diskNs
+                            + static_cast<double>(summary.writeBacks) * config.swap.ns) / n;
     }
+    return summary;
+}
+
+struct FrameDelta {
+    int step;
+    std::size_t frame;
+    Frame old; // contents replaced by the fault; old.valid is false for a cold fill
+    int page;
 };
 
-class LruState final : public AlgoState {
-    vector<int> lastUsed_;
+// Full step history stored as one delta per fault plus a copy of the frames every
+// checkpointEvery steps, instead of a frame copy per step. Steps without a delta are hits.
+class StepLog {
+    std::size_t length_ = 0;
+    std::size_t checkpointEvery_;
+    vector<FrameDelta> faults_;
+    vector<vector<Frame>> checkpoints_;   // frames before step c * checkpointEvery_
+    vector<std::size_t> checkpointFault_; // first entry of faults_ at or after that step
+    vector<Frame> current_;
 
 public:
-    explicit LruState(int frameCount) : lastUsed_(frameCount, -1) {}
+    StepLog(int frameCount, std::size_t checkpointEvery)
+        : checkpointEvery_(max<std::size_t>(checkpointEvery, 1)), current_(frameCount) {}
 
-    AccessRes access(int step, int page, vector<Frame>& frames, const vector<int>& /*ref*/) override {
-        for (std::size_t i = 0; i < frames.size(); ++i) {
-            if (frames[i].valid && frames[i].page == page) {
-                lastUsed_[i] = step;
-                return {true, -1};
-            }
-        }
+    std::size_t size() const { return length_; }
+    int frameCount() const { return static_cast<int>(current_.size()); }
+    std::size_t checkpointCount() const { return checkpoints_.size(); }
+    const vector<FrameDelta>& faults() const { return faults_; }
 
-        for (std::size_t i = 0; i < frames.size(); ++i) {
-            if (!frames[i].valid) {
-                frames[i].page  = page;
-                frames[i].valid = true;
-                lastUsed_[i]    = step;
-                return {false, i};
-            }
+    // Steps must be recorded in order, starting from 0.
+    void record(int page, bool hit, std::size_t victim) {
+        if (length_ % checkpointEvery_ == 0) {
+            checkpoints_.push_back(current_);
+            checkpointFault_.push_back(faults_.size());
+        }
+        if (!hit) {
+            faults_.push_back(FrameDelta{static_cast<int>(length_), victim, current_[victim], page});
+            current_[victim] = Frame{page, true};
         }
+        ++length_;
+    }
 
-        int victim = 0;
-        int oldest = lastUsed_[0];
-        for (std::size_t i = 1; i < frames.size(); ++i) {
-            if (lastUsed_[i] < oldest) {
-                oldest = lastUsed_[i];
-                victim = static_cast<int>(i);
-            }
+    // Frame state right after `step`, rebuilt from the nearest checkpoint at or before it.
+    vector<Frame> framesAt(std::size_t step) const {
+        const std::size_t c = step / checkpointEvery_;
+        vector<Frame> frames = checkpoints_[c];
+        for (std::size_t i = checkpointFault_[c];
+             i < faults_.size() && faults_[i].step <= static_cast<int>(step); ++i) {
+            frames[faults_[i].frame] = Frame{faults_[i].page, true};
         }
+        return frames;
+    }
+};
+
+StepLog simulateLog(AlgoState& state, int frameCount, span<const int> ref, span<const uint8_t> writes,
+                    std::size_t checkpointEvery = 1024) {
+    vector<Frame> frames(frameCount);
+    StepLog log(frameCount, checkpointEvery);
 
-        frames[victim].page  = page;
-        frames[victim].valid = true;
-        lastUsed_[victim]    = step;
-        return AccessRes{false, victim};
+    for (std::size_t step = 0; step < ref.size(); ++step) {
+        const bool write   = !writes.empty() && writes[step];
+        auto [hit, victim] = state.reference(static_cast<int>(step), ref[step], write, frames, ref);
+        log.record(ref[step], hit, victim);
     }
+
+    return log;
+}
+
+StepLog simulateLog(ReplaceAlgo algo, int frameCount, span<const int> ref, std::size_t checkpointEvery = 1024) {
+    const auto state = newAlgoState(algo, frameCount);
+    return simulateLog(*state, frameCount, ref, {}, checkpointEvery);
+}
+
+// Fault counts for every frame count at once: faults[k] is the number of faults with k frames
+// (faults[0] == references).
+struct MissRatioCurve {
+    std::size_t references = 0;
+    vector<std::size_t> faults;
 };
 
-class OptState final : public AlgoState {
+class FenwickTree {
+    vector<int> tree_;
+
 public:
-    explicit OptState(int /*frameCount*/) {}
+    explicit FenwickTree(std::size_t n) : tree_(n + 1, 0) {}
 
-    AccessRes access(int step, int page, vector<Frame>& frames, const vector<int>& ref) override {
-        for (const auto& [p, valid] : frames) {
-            if (valid && p == page) {
-                return {true, -1};
-            }
-        }
+    void add(std::size_t i, int delta) {
+        for (++i; i < tree_.size(); i += i & (~i + 1)) tree_[i] += delta;
+    }
 
-        for (std::size_t i = 0; i < frames.size(); ++i) {
-            if (!frames[i].valid) {
-                frames[i].page  = page;
-                frames[i].valid = true;
-                return {false, static_cast<int>(i)};
-            }
+    // Sum of positions [0, i).
+    int prefix(std::size_t i) const {
+        int sum = 0;
+        for (; i > 0; i -= i & (~i + 1)) sum += tree_[i];
+        return sum;
+    }
+};
+
+// hist[d] is the number of accesses at stack distance d; larger caches hit everything smaller ones do.
+// Accesses deeper than the histogram are misses at every frame count it covers.
+MissRatioCurve curveFromDistances(const vector<std::size_t>& hist, std::size_t references, std::size_t maxFrames) {
+    MissRatioCurve curve;
+    curve.references = references;
+    curve.faults.resize(maxFrames + 1);
+    std::size_t faults = references;
+    for (std::size_t k = 0; k <= maxFrames; ++k) {
+        if (k < hist.size()) faults -= hist[k];
+        curve.faults[k] = faults;
+    }
+    return curve;
+}
+
+// Mattson's stack algorithm for LRU: an access hits with k frames iff its stack distance (the
+// number of distinct pages touched since the previous access to the same page, plus one) is at
+// most k. Only the latest position of each page is marked in the tree, so the distance is a
+// range count and the whole curve costs O(n log n). maxFrames == 0 means up to the distinct page count.
+MissRatioCurve lruMissRatioCurve(span<const int> ref, std::size_t maxFrames = 0) {
+    FenwickTree latest(ref.size());
+    unordered_map<int, std::size_t> lastPos;
+    lastPos.reserve(ref.size() / 4 + 16);
+    // A distance never exceeds the distinct pages seen so far, so without a cap the histogram
+    // grows with them rather than with the trace.
+    vector<std::size_t> hist(maxFrames + 1, 0);
+
+    for (std::size_t t = 0; t < ref.size(); ++t) {
+        auto [it, cold] = lastPos.try_emplace(ref[t], t);
+        if (cold) {
+            if (maxFrames == 0) hist.push_back(0);
+        } else {
+            const std::size_t p = it->second;
+            const auto distance = static_cast<std::size_t>(latest.prefix(t) - latest.prefix(p + 1)) + 1;
+            if (distance < hist.size()) ++hist[distance];
+            latest.add(p, -1);
+            it->second = t;
         }
+        latest.add(t, 1);
+    }
 
-        int victim          = -1;
-        int farthestNextUse = -1;
+    return curveFromDistances(hist, ref.size(), maxFrames ? maxFrames : lastPos.size());
+}
 
-        for (std::size_t i = 0; i < frames.size(); ++i) {
-            int nextUse = -1;
-            for (std::size_t j = step + 1; j < ref.size(); ++j) {
-                if (ref[j] == frames[i].page) {
-                    nextUse = static_cast<int>(j);
-                    break;
-                }
-            }
+// Belady's OPT is a stack algorithm when pages are ranked by their next use, so the same
+// histogram can be built in one pass with Mattson's priority stack: the accessed page moves to
+// the top, and on the way down to its old depth each level keeps whichever of (carried page,
+// resident page) is used sooner and carries the other one further. Each access costs O(depth),
+// and the stack is cut at maxFrames because deeper levels never affect smaller caches.
+MissRatioCurve optMissRatioCurve(span<const int> ref, std::size_t maxFrames = 0) {
+    const auto nextUse = nextUseIndices(ref);
+    vector<pair<int, int>> stack; // (page, next use), top first
+    vector<std::size_t> hist(maxFrames + 1, 0); // one entry per stack level, grown with the stack
 
-            if (nextUse == -1) {
-                victim = static_cast<int>(i);
-                break;
-            }
+    for (std::size_t t = 0; t < ref.size(); ++t) {
+        std::size_t depth = 0;
+        while (depth < stack.size() && stack[depth].first != ref[t]) ++depth;
+        if (depth < stack.size()) ++hist[depth + 1];
 
-            if (nextUse > farthestNextUse) {
-                farthestNextUse = nextUse;
-                victim          = static_cast<int>(i);
-            }
+        pair<int, int> carry{ref[t], nextUse[t]};
+        for (std::size_t level = 0; level < depth; ++level) {
+            if (level == 0 || stack[level].second > carry.second) swap(stack[level], carry);
         }
-
-        if (victim == -1) {
-            victim = 0;
+        if (depth < stack.size()) {
+            stack[depth] = carry;
+        } else if (maxFrames == 0 || stack.size() < maxFrames) {
+            stack.push_back(carry);
+            if (maxFrames == 0) hist.push_back(0);
         }
+    }
 
-        frames[victim].page  = page;
-        frames[victim].valid = true;
-        return {false, victim};
+    return curveFromDistances(hist, ref.size(), maxFrames ? maxFrames : stack.size());
+}
+
+// Policies without the inclusion property need one run per frame count. This runs every
+// (algorithm, frame count) pair up to maxFrames on a pool of threads sharing the trace read-only;
+// each worker claims the next pair from a shared counter, so a slow policy does not leave the
+// other threads idle behind a fixed split.
+vector<MissRatioCurve> sweepMissRatioCurves(const vector<ReplaceAlgo>& algos, std::size_t maxFrames,
+                                            span<const int> ref, span<const uint8_t> writes,
+                                            const PolicyConfig& config, unsigned threads = 0,
+                                            const PrefetchConfig& prefetch = {}) {
+    vector<MissRatioCurve> curves(algos.size());
+    for (auto& curve : curves) {
+        curve.references = ref.size();
+        curve.faults.assign(maxFrames + 1, ref.size());
     }
-};
 
-unique_ptr<AlgoState> newAlgoState(ReplaceAlgo algo, int frameCount) {
-    switch (algo) {
-        case ReplaceAlgo::Fifo_algo:
-            return make_unique<FifoState>(frameCount);
-        case ReplaceAlgo::Opt_algo:
-            return make_unique<OptState>(frameCount);
-        case ReplaceAlgo::Lru_algo:
-            return make_unique<LruState>(frameCount);
-        default:
-            return make_unique<FifoState>(frameCount);
+    const std::size_t jobs = algos.size() * maxFrames;
+    if (threads == 0) threads = max(1u, thread::hardware_concurrency());
+    threads = static_cast<unsigned>(min<std::size_t>(threads, max<std::size_t>(jobs, 1)));
+
+    atomic<std::size_t> next{0};
+    const auto worker = [&] {
+        for (std::size_t job; (job = next.fetch_add(1, memory_order_relaxed)) < jobs;) {
+            // Largest frame counts first, they tend to be the slowest runs.
+            const std::size_t a = job % algos.size();
+            const auto frames   = static_cast<int>(maxFrames - job / algos.size());
+            const auto state    = newAlgoState(algos[a], frames, config);
+            curves[a].faults[frames] = simulateSummary(*state, frames, ref, writes, 0, prefetch).faults;
+        }
+    };
+    vector<thread> pool;
+    for (unsigned t = 1; t < threads; ++t) pool.emplace_back(worker);
+    worker();
+    for (auto& t : pool) t.join();
+    return curves;
+}
+
+// Frame counts k at which k + 1 frames fault more often than k (Belady's anomaly).
+vector<std::size_t> beladyAnomalies(const MissRatioCurve& curve) {
+    vector<std::size_t> ks;
+    for (std::size_t k = 1; k + 1 < curve.faults.size(); ++k) {
+        if (curve.faults[k + 1] > curve.faults[k]) ks.push_back(k);
     }
+    return ks;
 }
 
-struct StepResult {
-    int step;
-    int page;
-    bool hit;
-    std::size_t victim;
-    vector<Frame> frames;
+// k + 1 frames faulting more than k over the whole trace, and the shortest prefix of the trace
+// that already shows it.
+struct BeladyWitness {
+    std::size_t frames;
+    std::size_t faults;     // with frames frames
+    std::size_t moreFaults; // with frames + 1 frames
+    std::size_t prefix;
 };
 
-vector<StepResult> simulate(ReplaceAlgo algo, int frameCount, const vector<int>& ref) {
-    vector<Frame> frames(frameCount);
-    auto state = newAlgoState(algo, frameCount);
-    vector<StepResult> results;
-    results.reserve(ref.size());
+// Runs the policy with 1..maxFrames frames side by side in one pass, so each fault count after
+// every prefix is known without rerunning the prefix. OPT decides with the whole trace in view,
+// so its prefix counts are not runs on the prefix; it is a stack algorithm and never anomalous
+// anyway, and callers should not pass it.
+vector<BeladyWitness> findBeladyAnomalies(ReplaceAlgo algo, std::size_t maxFrames, span<const int> ref,
+                                          span<const uint8_t> writes, const PolicyConfig& config) {
+    const std::size_t n = maxFrames;
+    vector<unique_ptr<AlgoState>> states;
+    vector<vector<Frame>> frames;
+    for (std::size_t k = 1; k <= n; ++k) {
+        states.push_back(newAlgoState(algo, static_cast<int>(k), config));
+        frames.emplace_back(k);
+    }
+    vector<std::size_t> faults(n, 0);
+    vector<std::size_t> firstPrefix(n, 0); // 0 until k + 1 frames are first behind
 
-    for (std::size_t step = 0; step < ref.size(); ++step) {
-        auto [hit, victim] = state->access(static_cast<int>(step), ref[step], frames, ref);
-        results.push_back(StepResult{static_cast<int>(step), ref[step], hit, victim, frames,});
+    for (std::size_t t = 0; t < ref.size(); ++t) {
+        const bool write = !writes.empty() && writes[t];
+        for (std::size_t i = 0; i < n; ++i) {
+            faults[i] += !states[i]->reference(static_cast<int>(t), ref[t], write, frames[i], ref).hit;
+        }
+        for (std::size_t i = 0; i + 1 < n; ++i) {
+            if (!firstPrefix[i] && faults[i + 1] > faults[i]) firstPrefix[i] = t + 1;
+        }
     }
 
-    return results;
+    vector<BeladyWitness> witnesses;
+    for (std::size_t i = 0; i + 1 < n; ++i) {
+        if (faults[i + 1] > faults[i]) witnesses.push_back({i + 1, faults[i], faults[i + 1], firstPrefix[i]});
+    }
+    return witnesses;
 }
 
+const vector<ReplaceAlgo> allAlgos = {
+        ReplaceAlgo::Fifo_algo,
+        ReplaceAlgo::Opt_algo,
+        ReplaceAlgo::Lru_algo,
+        ReplaceAlgo::Clock_algo,
+        ReplaceAlgo::Esc_algo,
+        ReplaceAlgo::Arc_algo,
+        ReplaceAlgo::Lirs_algo,
+        ReplaceAlgo::TwoQ_algo,
+        ReplaceAlgo::Linux_algo,
+        ReplaceAlgo::Lfu_algo,
+        ReplaceAlgo::WsClock_algo,
+        ReplaceAlgo::Aging_algo,
+};
+
 string algoName(ReplaceAlgo algo) {
     switch (algo) {
         case ReplaceAlgo::Fifo_algo: return "FIFO";
         case ReplaceAlgo::Opt_algo: return "OPT";
         case ReplaceAlgo::Lru_algo: return "LRU";
+        case ReplaceAlgo::Clock_algo: return "CLOCK";
+        case ReplaceAlgo::Esc_algo: return "ESC";
+        case ReplaceAlgo::Arc_algo: return "ARC";
+        case ReplaceAlgo::Lirs_algo: return "LIRS";
+        case ReplaceAlgo::TwoQ_algo: return "2Q";
+        case ReplaceAlgo::Linux_algo: return "LINUX";
+        case ReplaceAlgo::Lfu_algo: return "LFU";
+        case ReplaceAlgo::WsClock_algo: return "WSCLOCK";
+        case ReplaceAlgo::Aging_algo: return "AGING";
     }
     return "Unknown";
 }
 
-string frameSnapshot(const vector<Frame>& frames) {
+// Page numbers to print for the page ids, e.g. from trace::pagesOf; empty when ids are page numbers.
+using PageNames = span<const uint64_t>;
+
+string pageName(int page, PageNames names) {
+    return names.empty() ? to_string(page) : to_string(names[static_cast<std::size_t>(page)]);
+}
+
+string frameSnapshot(const vector<Frame>& frames, PageNames names = {}) {
     ostringstream oss;
     oss << "[";
     for (std::size_t i = 0; i < frames.size(); ++i) {
         if (i) oss << " | ";
-        if (frames[i].valid) oss << frames[i].page;
+        if (frames[i].valid) oss << pageName(frames[i].page, names);
         else oss << "-";
     }
     oss << "]";
     return oss.str();
 }
 
-void printResults(const vector<StepResult>& results) {
-    int hits   = 0;
-    int faults = 0;
+// Page column wide enough for the longest page number plus a gap; 8 when ids are printed as is.
+int pageColumnWidth(PageNames names) {
+    if (names.empty()) return 8;
+    return max(8, static_cast<int>(to_string(*ranges::max_element(names)).size()) + 2);
+}
 
+void printStepHeader(int pageWidth = 8) {
     cout << left
             << setw(6) << "Step"
-            << setw(8) << "Page"
+            << setw(pageWidth) << "Page"
             << setw(8) << "Hit?"
             << setw(10) << "Victim"
             << "Frames\n";
     cout << string(60, '-') << "\n";
+}
+
+void printStepRow(int step, int page, bool hit, std::size_t victim, const vector<Frame>& frames,
+                  PageNames names = {}, int pageWidth = 8) {
+    cout << left
+            << setw(6) << step
+            << setw(pageWidth) << pageName(page, names)
+            << setw(8) << (hit ? "Yes" : "No")
+            << setw(10) << (hit ? "-" : to_string(victim))
+            << frameSnapshot(frames, names) << "\n";
+}
 
-    for (const auto& [step, page, hit, victim, frames] : results) {
-        if (hit) ++hits;
+void printStepRow(const StepResult& r, PageNames names = {}, int pageWidth = 8) {
+    printStepRow(r.step, r.page, r.hit, r.victim, r.frames, names, pageWidth);
+}
+
+void printResults(const vector<StepResult>& results) {
+    int hits   = 0;
+    int faults = 0;
+
+    printStepHeader();
+    for (const auto& r : results) {
+        if (r.hit) ++hits;
         else ++faults;
-        cout << left
-                << setw(6) << step
-                << setw(8) << page
-                << setw(8) << (hit ? "Yes" : "No")
-                << setw(10) << (victim >= 0 ? to_string(victim) : "-")
-                << frameSnapshot(frames) << "\n";
+        printStepRow(r);
     }
 
     cout << "\nHits: " << hits << ", Faults: " << faults
@@ -236,11 +2376,215 @@ void printResults(const vector<StepResult>& results) {
             << "\n";
 }
 
+// Renders the same table as above by replaying the log's deltas; pages on hit steps come from `ref`.
+void printResults(const StepLog& log, span<const int> ref, PageNames names = {}) {
+    vector<Frame> frames(log.frameCount());
+    const auto& faults = log.faults();
+    std::size_t next   = 0;
+    const int pageWidth = pageColumnWidth(names);
+
+    printStepHeader(pageWidth);
+    for (std::size_t step = 0; step < log.size(); ++step) {
+        const bool hit = next == faults.size() || faults[next].step != static_cast<int>(step);
+        std::size_t victim = noIndex;
+        if (!hit) {
+            victim         = faults[next].frame;
+            frames[victim] = Frame{faults[next].page, true};
+            ++next;
+        }
+        printStepRow(static_cast<int>(step), ref[step], hit, victim, frames, names, pageWidth);
+    }
+
+    const std::size_t hits = log.size() - faults.size();
+    cout << "\nHits: " << hits << ", Faults: " << faults.size()
+            << ", Hit Ratio: " << (log.size() ? static_cast<double>(hits) / log.size() : 0.0)
+            << "\n";
+}
+
+void printSummary(const SimSummary& summary, const CostModel& cost = {}, PageNames names = {}) {
+    if (!summary.samples.empty()) {
+        // Pages only ever prefetched have ids past the trace's own.
+        vector<uint64_t> allNames;
+        if (!summary.unreferencedPages.empty()) {
+            allNames.assign(names.begin(), names.end());
+            allNames.insert(allNames.end(), summary.unreferencedPages.begin(), summary.unreferencedPages.end());
+            names = allNames;
+        }
+        const int pageWidth = pageColumnWidth(names);
+        printStepHeader(pageWidth);
+        for (const auto& r : summary.samples) {
+            printStepRow(r, names, pageWidth);
+        }
+        cout << "\n";
+    }
+
+    cout << "References: " << summary.references
+            << ", Hits: " << summary.hits
+            << ", Faults: " << summary.faults
+            << ", Evictions: " << summary.evictions
+            << ", Hit Ratio: "
+            << (summary.references ? static_cast<double>(summary.hits) / summary.references : 0.0)
+            << "\n";
+    cout << "Writes: " << summary.writes
+            << ", Write-backs: " << summary.writeBacks
+            << ", Effective access time: " << effectiveAccessNs(summary, cost) << " ns\n";
+    if (summary.prefetches) {
+        cout << "Prefetches: " << summary.prefetches << ", Useful: " << summary.usefulPrefetches
+                << ", Wasted: " << summary.wastedPrefetches << "\n";
+    }
+}
+
+// One row per frame count with a fault and miss-ratio column per curve, so curves can be plotted together.
+void printCurves(const vector<pair<string, MissRatioCurve>>& curves) {
+    std::size_t rows = 0;
+    cout << left << setw(8) << "Frames";
+    for (const auto& [name, curve] : curves) {
+        cout << setw(12) << (name + " Faults") << setw(12) << (name + " Miss");
+        rows = max(rows, curve.faults.size());
+    }
+    cout << "\n" << string(8 + 24 * curves.size(), '-') << "\n";
+
+    for (std::size_t k = 1; k < rows; ++k) {
+        cout << left << setw(8) << k;
+        for (const auto& [name, curve] : curves) {
+            // A curve that stops early has reached its distinct page count; it stays flat from there.
+            const std::size_t faults = curve.faults[min(k, curve.faults.size() - 1)];
+            cout << setw(12) << faults
+                    << setw(12) << (curve.references ? static_cast<double>(faults) / curve.references : 0.0);
+        }
+        cout << "\n";
+    }
+}
+
+void printBeladyReport(const vector<BeladyWitness>& witnesses, span<const int> ref, PageNames names = {}) {
+    if (witnesses.empty()) {
+        cout << "No anomaly found.\n";
+        return;
+    }
+    constexpr std::size_t shown = 40;
+    for (const auto& w : witnesses) {
+        cout << w.frames << " -> " << w.frames + 1 << " frames: " << w.faults << " -> " << w.moreFaults
+                << " faults; shortest witness is the first " << w.prefix << " references:";
+        for (std::size_t t = 0; t < min(w.prefix, shown); ++t) cout << " " << pageName(ref[t], names);
+        if (w.prefix > shown) cout << " ...";
+        cout << "\n";
+    }
+}
+
+// Runs each algorithm in summary mode on the same trace and reports fault rate next to throughput.
+void printComparison(const vector<ReplaceAlgo>& algos, int frameCount, span<const int> ref,
+                     span<const uint8_t> writes, const PolicyConfig& config, const CostModel& cost,
+                     const PrefetchConfig& prefetch = {}) {
+    const bool prefetching = prefetch.kind != PrefetchKind::None;
+    cout << left << setw(8) << "Algo" << setw(12) << "Faults" << setw(12) << "Hit Ratio" << setw(12) << "Write-backs"
+            << setw(12) << "EAT (ns)";
+    if (prefetching) cout << setw(12) << "Prefetched" << setw(12) << "Useful" << setw(12) << "Wasted";
+    cout << setw(12) << "Time (ms)" << "Mrefs/s\n";
+    cout << string(prefetching ? 116 : 80, '-') << "\n";
+    for (const auto algo : algos) {
+        const auto start   = chrono::steady_clock::now();
+        const auto state   = newAlgoState(algo, frameCount, config);
+        const auto summary = simulateSummary(*state, frameCount, ref, writes, 0, prefetch);
+        const chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+        cout << left << setw(8) << algoName(algo) << setw(12) << summary.faults
+                << setw(12) << (summary.references ? static_cast<double>(summary.hits) / summary.references : 0.0)
+                << setw(12) << summary.writeBacks << setw(12) << effectiveAccessNs(summary, cost);
+        if (prefetching) {
+            cout << setw(12) << summary.prefetches << setw(12) << summary.usefulPrefetches
+                    << setw(12) << summary.wastedPrefetches;
+        }
+        cout << setw(12) << elapsed.count()
+                << (elapsed.count() > 0 ? summary.references / elapsed.count() / 1000.0 : 0.0) << "\n";
+    }
+}
+
+void printHierarchy(const HierarchySummary& summary, const HierarchyConfig& config) {
+    const int swapEntries = config.swap.entries ? config.swap.entries : 4 * config.ram.entries;
+    cout << left << setw(8) << "Level" << setw(10) << "Entries" << setw(8) << "Algo" << setw(12) << "Accesses"
+            << setw(12) << "Hits" << setw(12) << "Hit Rate" << "Latency (ns)\n";
+    cout << string(74, '-') << "\n";
+    const auto row = [](const char* name, const TierConfig& tier, int entries, const TierStats& stats) {
+        cout << left << setw(8) << name << setw(10) << entries << setw(8) << algoName(tier.algo)
+                << setw(12) << stats.accesses << setw(12) << stats.hits
+                << setw(12) << (stats.accesses ? static_cast<double>(stats.hits) / stats.accesses : 0.0)
+                << tier.ns << "\n";
+    };
+    row("TLB", config.tlb, config.tlb.entries, summary.tlb);
+    row("RAM", config.ram, config.ram.entries, summary.ram);
+    row("Swap", config.swap, swapEntries, summary.swap);
+    cout << "\nTLB walks: " << summary.tlb.accesses - summary.tlb.hits << " (" << config.walkNs << " ns each, "
+            << summary.staleTlbHits << " of them TLB hits for evicted pages)"
+            << ", disk reads: " << summary.swap.accesses - summary.swap.hits << " (" << config.diskNs << " ns each)"
+            << ", write-backs to swap: " << summary.writeBacks << "\n";
+    cout << "Average memory access time: " << summary.amatNs << " ns\n";
+}
+
+// Times one page lookup per method on a full set of frames, with half of the lookups hitting:
+// the scan over vector<Frame> the policies used to do, the packed vector scan ResidencyIndex uses
+// up to packedLimit frames, and the hash table it uses above that.
+void printLookupBench(std::size_t lookups) {
+    cout << left << setw(8) << "Frames" << setw(16) << "Scan (ns)" << setw(16) << "Packed (ns)" << "Hash (ns)\n";
+    cout << string(56, '-') << "\n";
+    uint64_t seed = 88172645463325252ULL;
+    const auto next = [&] { // xorshift64, cheap enough not to dominate the timings
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        return seed;
+    };
+    for (std::size_t n = 8; n <= 512; n *= 2) {
+        vector<Frame> frames(n);
+        vector<int> slots(n); // n is a multiple of 8, so no padding is needed
+        ResidencyIndex hashed(static_cast<int>(n), false);
+        vector<Frame> scratch(n);
+        for (std::size_t f = 0; f < n; ++f) {
+            const int page = static_cast<int>(f * 7 + 3);
+            frames[f]      = Frame{page, true};
+            slots[f]       = page;
+            hashed.install(scratch, hashed.takeFree(), page);
+        }
+        vector<int> queries(lookups);
+        for (auto& q : queries) q = static_cast<int>(next() % (2 * n)) * 7 + 3; // pages of frames [0, n) resident
+
+        std::size_t check[3] = {0, 0, 0};
+        double ns[3];
+        const auto time = [&](int method, auto&& lookup) {
+            const auto start = chrono::steady_clock::now();
+            for (const int q : queries) check[method] += lookup(q);
+            const chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start;
+            ns[method] = elapsed.count() / static_cast<double>(lookups);
+        };
+        time(0, [&](int page) {
+            for (std::size_t f = 0; f < frames.size(); ++f) {
+                if (frames[f].valid && frames[f].page == page) return f;
+            }
+            return noIndex;
+        });
+        time(1, [&](int page) {
+            const std::size_t f = simd::findEqual(slots.data(), slots.size(), page);
+            return f < slots.size() ? f : noIndex;
+        });
+        time(2, [&](int page) { return hashed.find(page); });
+
+        cout << left << setw(8) << n << setw(16) << ns[0] << setw(16) << ns[1] << ns[2]
+                << (check[0] == check[1] && check[1] == check[2] ? "" : "  (lookup results differ!)") << "\n";
+    }
+}
+
 ReplaceAlgo selectAlgo(int choice) {
     switch (choice) {
         case 1: return ReplaceAlgo::Fifo_algo;
         case 2: return ReplaceAlgo::Opt_algo;
         case 3: return ReplaceAlgo::Lru_algo;
+        case 5: return ReplaceAlgo::Clock_algo;
+        case 6: return ReplaceAlgo::Esc_algo;
+        case 7: return ReplaceAlgo::Arc_algo;
+        case 8: return ReplaceAlgo::Lirs_algo;
+        case 9: return ReplaceAlgo::TwoQ_algo;
+        case 10: return ReplaceAlgo::Linux_algo;
+        case 11: return ReplaceAlgo::Lfu_algo;
+        case 12: return ReplaceAlgo::WsClock_algo;
+        case 13: return ReplaceAlgo::Aging_algo;
         default: return ReplaceAlgo::Fifo_algo;
     }
 }
@@ -257,6 +2601,15 @@ void runTests() {
             {ReplaceAlgo::Fifo_algo, 3, {7, 0, 1, 2, 0, 3, 0, 4, 2, 3, 0, 3, 2}, "FIFO example with 3 frames"},
             {ReplaceAlgo::Opt_algo, 4, {1, 2, 3, 4, 1, 2, 5, 1, 2, 3, 4, 5}, "OPT example with 4 frames"},
             {ReplaceAlgo::Lru_algo, 3, {2, 3, 2, 1, 5, 2, 4, 5, 3, 2, 5, 2}, "LRU example with 3 frames"},
+            {ReplaceAlgo::Clock_algo, 3, {2, 3, 2, 1, 5, 2, 4, 5, 3, 2, 5, 2}, "CLOCK on the LRU example"},
+            {ReplaceAlgo::Esc_algo, 4, {1, 2, 3, 4, 1, 2, 5, 1, 2, 3, 4, 5}, "Enhanced second chance with 4 frames"},
+            {ReplaceAlgo::Arc_algo, 3, {1, 2, 3, 1, 4, 5, 1, 2, 6, 1, 2, 3, 4, 1, 2}, "ARC with 3 frames"},
+            {ReplaceAlgo::Lirs_algo, 3, {1, 2, 3, 4, 1, 2, 3, 4, 1, 2, 3, 4, 1, 2, 3, 4}, "LIRS on a loop one page larger than memory"},
+            {ReplaceAlgo::TwoQ_algo, 4, {1, 2, 1, 3, 4, 5, 6, 2, 1, 7, 8, 2, 1, 9, 2, 1}, "2Q keeps re-referenced pages through a scan"},
+            {ReplaceAlgo::Linux_algo, 4, {1, 2, 1, 3, 4, 5, 6, 2, 1, 7, 8, 2, 1, 9, 2, 1}, "Linux two-list on the same trace"},
+            {ReplaceAlgo::Lfu_algo, 3, {1, 1, 1, 2, 2, 3, 4, 3, 4, 5, 1, 2, 5, 4}, "LFU keeps the hot pages 1 and 2"},
+            {ReplaceAlgo::WsClock_algo, 4, {1, 2, 3, 1, 2, 4, 1, 2, 5, 6, 1, 2, 7, 1, 2, 3}, "WSClock with 4 frames"},
+            {ReplaceAlgo::Aging_algo, 3, {2, 3, 2, 1, 5, 2, 4, 5, 3, 2, 5, 2}, "Aging on the LRU example"},
     };
 
     cout << "\n===== Running Built-in Tests =====\n";
@@ -264,15 +2617,613 @@ void runTests() {
         cout << "\nTest: " << desc << "\n";
         cout << "Algorithm: " << algoName(algo) << ", Frames: " << frames
                 << ", Reference length: " << refs.size() << "\n";
-        auto results = simulate(algo, frames, refs);
+        const auto state = newAlgoState(algo, frames);
+        auto results     = simulate(*state, frames, refs, {});
         printResults(results);
+        state->printStats(cout);
+
+        cout << "\nSummary mode, sampling every 4th reference:\n";
+        printSummary(simulateSummary(algo, frames, refs, 4));
+
+        const auto log = simulateLog(algo, frames, refs, 5);
+        bool same      = log.size() == results.size();
+        for (std::size_t i = 0; same && i < results.size(); ++i) {
+            same = log.framesAt(i) == results[i].frames;
+        }
+        cout << "Delta log: " << log.faults().size() << " deltas, " << log.checkpointCount()
+                << " checkpoints, reconstruction " << (same ? "OK" : "MISMATCH") << "\n";
+    }
+
+    const vector<int> curveRefs = {7, 0, 1, 2, 0, 3, 0, 4, 2, 3, 0, 3, 2, 1, 2, 0, 1, 7, 0, 1};
+    const auto checkCurve       = [&](ReplaceAlgo algo, const MissRatioCurve& curve) {
+        cout << "\nTest: " << algoName(algo) << " miss-ratio curve in one pass\n";
+        printCurves({{algoName(algo), curve}});
+        bool same = true;
+        for (std::size_t k = 1; k < curve.faults.size(); ++k) {
+            same = same && simulateSummary(algo, static_cast<int>(k), curveRefs).faults == curve.faults[k];
+        }
+        cout << "Matches per-frame-count simulate: " << (same ? "OK" : "MISMATCH") << "\n";
+    };
+    checkCurve(ReplaceAlgo::Lru_algo, lruMissRatioCurve(curveRefs));
+    checkCurve(ReplaceAlgo::Opt_algo, optMissRatioCurve(curveRefs));
+
+    cout << "\nTest: parallel sweep on Belady's string, 1-5 frames\n";
+    const vector<int> beladyRefs = {1, 2, 3, 4, 1, 2, 5, 1, 2, 3, 4, 5};
+    const auto swept = sweepMissRatioCurves({ReplaceAlgo::Fifo_algo, ReplaceAlgo::Lru_algo}, 5, beladyRefs, {},
+                                            PolicyConfig{}, 4);
+    printCurves({{"FIFO", swept[0]}, {"LRU", swept[1]}});
+    const auto fifoAnomalies = beladyAnomalies(swept[0]);
+    const auto witnesses = findBeladyAnomalies(ReplaceAlgo::Fifo_algo, 4, beladyRefs, {}, PolicyConfig{});
+    printBeladyReport(witnesses, beladyRefs);
+    cout << "FIFO anomaly at 3 -> 4 frames: "
+            << (fifoAnomalies == vector<std::size_t>{3} && beladyAnomalies(swept[1]).empty()
+                && witnesses.size() == 1 && witnesses[0].frames == 3 && witnesses[0].prefix == beladyRefs.size()
+                ? "OK" : "MISMATCH")
+            << "\n";
+
+    cout << "\nTest: Aging (32-bit, tick every reference) against exact LRU\n";
+    PolicyConfig tickEveryRef;
+    tickEveryRef.agingInterval = 1;
+    tickEveryRef.agingBits     = 32;
+    bool agingIsLru            = true;
+    for (int frames = 2; frames <= 6; ++frames) {
+        const auto aging      = newAlgoState(ReplaceAlgo::Aging_algo, frames, tickEveryRef);
+        const auto agingFaults = simulateSummary(*aging, frames, curveRefs, {}).faults;
+        const auto lruFaults   = simulateSummary(ReplaceAlgo::Lru_algo, frames, curveRefs).faults;
+        cout << "Frames " << frames << ": Aging faults " << agingFaults << ", LRU faults " << lruFaults << "\n";
+        agingIsLru = agingIsLru && agingFaults == lruFaults;
+    }
+    cout << "Aging matches LRU: " << (agingIsLru ? "OK" : "MISMATCH") << "\n";
+
+    cout << "\nTest: write-back cost on a write-heavy trace, 3 frames\n";
+    const vector<int> rwPages     = {1, 2, 3, 1, 4, 2, 5, 1, 2, 3, 4, 5, 1, 2, 6, 1, 3, 2};
+    const vector<uint8_t> rwFlags = {1, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 1, 0, 0};
+    printComparison({ReplaceAlgo::Lru_algo, ReplaceAlgo::Clock_algo, ReplaceAlgo::Esc_algo}, 3, rwPages, rwFlags,
+                    PolicyConfig{}, CostModel{});
+
+    cout << "\nTest: prefetching on sequential runs with random pages between, LRU, 16 frames\n";
+    vector<int> scanRefs;
+    for (int run = 0; run < 8; ++run) {
+        for (int p = 0; p < 24; ++p) scanRefs.push_back(1000 * run + p);
+        for (int r = 0; r < 6; ++r) scanRefs.push_back((run * 37 + r * 11) % 50);
+    }
+    const auto lruPrefetch = [&](PrefetchKind kind) {
+        const auto state = newAlgoState(ReplaceAlgo::Lru_algo, 16);
+        return simulateSummary(*state, 16, scanRefs, {}, 0, PrefetchConfig{.kind = kind});
+    };
+    const auto plain     = lruPrefetch(PrefetchKind::None);
+    const auto nextN     = lruPrefetch(PrefetchKind::NextN);
+    const auto readahead = lruPrefetch(PrefetchKind::Readahead);
+    for (const auto& [name, summary] : {pair{"none", plain}, pair{"next-4", nextN}, pair{"readahead", readahead}}) {
+        cout << left << setw(10) << name << " faults " << summary.faults << ", prefetched " << summary.prefetches
+                << ", useful " << summary.usefulPrefetches << ", wasted " << summary.wastedPrefetches << "\n";
     }
+    const auto accounted = [](const SimSummary& s) {
+        return s.usefulPrefetches + s.wastedPrefetches <= s.prefetches && s.hits + s.faults == s.references;
+    };
+    cout << "Prefetching cuts faults and every prefetch is counted once: "
+            << (nextN.faults < plain.faults && readahead.faults < plain.faults && accounted(nextN)
+                && accounted(readahead) ? "OK" : "MISMATCH") << "\n";
+
+    cout << "\nTest: next-4 prefetching keeps the page just referenced, every policy but OPT, 5 frames\n";
+    bool kept = true;
+    for (const auto algo : allAlgos) {
+        if (algo == ReplaceAlgo::Opt_algo) continue;
+        const auto state   = newAlgoState(algo, 5);
+        const auto summary = simulateSummary(*state, 5, scanRefs, {}, 1, PrefetchConfig{.kind = PrefetchKind::NextN});
+        for (const auto& [step, page, hit, victim, frames] : summary.samples) {
+            kept = kept && ranges::any_of(frames, [&](const Frame& f) { return f.valid && f.page == page; });
+        }
+    }
+    cout << "Referenced page resident after its prefetches: " << (kept ? "OK" : "MISMATCH") << "\n";
+
+    cout << "\nTest: next-4 prefetching on 4K pages cut from addresses, scans up and down 64 pages, LRU, 8 frames\n";
+    const auto scanAddresses = [&](bool down) {
+        trace::AddressTrace addresses;
+        for (int pass = 0; pass < 3; ++pass) {
+            for (uint64_t p = 0; p < 64; ++p) addresses.addresses.push_back(((down ? 63 - p : p) << 12) + 8);
+        }
+        trace::RefTrace pages;
+        vector<uint64_t> numbers;
+        unordered_map<uint64_t, int> ids;
+        trace::pagesOf(addresses, 12, pages, numbers, ids);
+        const auto state = newAlgoState(ReplaceAlgo::Lru_algo, 8);
+        return simulateSummary(*state, 8, pages.pages, {}, 0,
+                               PrefetchConfig{.kind = PrefetchKind::NextN, .pages = PageNumbering{numbers, &ids}});
+    };
+    const auto up   = scanAddresses(false);
+    const auto down = scanAddresses(true);
+    cout << "up: useful " << up.usefulPrefetches << " of " << up.prefetches << "; down: useful "
+            << down.usefulPrefetches << " of " << down.prefetches << "\n";
+    cout << "Prefetches follow page numbers, not first-use ids: "
+            << (up.usefulPrefetches > 0 && down.usefulPrefetches == 0 ? "OK" : "MISMATCH") << "\n";
+
+    cout << "\nTest: TLB -> RAM -> swap on the curve trace, 4-entry TLB, 3 frames, 5 swap slots\n";
+    HierarchyConfig levels;
+    levels.tlb.entries  = 4;
+    levels.ram.entries  = 3;
+    levels.swap.entries = 5;
+    const auto tiers    = simulateHierarchy(curveRefs, {}, levels);
+    printHierarchy(tiers, levels);
+    cout << "RAM level matches a plain LRU run, swap sees exactly the RAM faults: "
+            << (tiers.ram.accesses - tiers.ram.hits == simulateSummary(ReplaceAlgo::Lru_algo, 3, curveRefs).faults
+                && tiers.swap.accesses == tiers.ram.accesses - tiers.ram.hits ? "OK" : "MISMATCH") << "\n";
+
+    cout << "\nTest: a dirty page RAM evicts is written to swap and faults back in from there\n";
+    HierarchyConfig small;
+    small.tlb.entries  = 4;
+    small.ram.entries  = 3;
+    small.swap.entries = 2;
+    const vector<int> dirtyRefs       = {1, 2, 3, 4, 1};
+    const vector<uint8_t> dirtyWrites = {1, 0, 0, 0, 0};
+    const auto written                = simulateHierarchy(dirtyRefs, dirtyWrites, small);
+    printHierarchy(written, small);
+    cout << "Page 1 hits in swap after its write-back: "
+            << (written.writeBacks == 1 && written.swap.hits == 1 && written.swap.accesses == 5 ? "OK" : "MISMATCH")
+            << "\n";
+
+    cout << "\nTest: ESC in RAM writes page 1 back while evicting clean page 2; page 1 refaults from swap\n";
+    HierarchyConfig escRam = small;
+    escRam.ram.algo        = ReplaceAlgo::Esc_algo;
+    escRam.swap.entries    = 3;
+    const vector<int> escRefs       = {1, 2, 3, 4, 5, 6, 1};
+    const vector<uint8_t> escWrites = {1, 0, 0, 0, 0, 0, 0};
+    const auto escTiers             = simulateHierarchy(escRefs, escWrites, escRam);
+    printHierarchy(escTiers, escRam);
+    cout << "Swap holds the page written back, not the victim: "
+            << (escTiers.writeBacks == 1 && escTiers.swap.hits == 1 ? "OK" : "MISMATCH") << "\n";
     cout << "\n===== Tests Finished =====\n\n";
 }
 
-int main() {
+bool parseAlgo(string name, ReplaceAlgo& algo) {
+    for (auto& c : name) c = static_cast<char>(toupper(static_cast<unsigned char>(c)));
+    for (const auto a : allAlgos) {
+        if (algoName(a) == name) {
+            algo = a;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Comma-separated algorithm names, e.g. "lru,clock,esc".
+bool parseAlgoList(const string& text, vector<ReplaceAlgo>& algos) {
+    algos.clear();
+    istringstream iss(text);
+    string name;
+    while (getline(iss, name, ',')) {
+        ReplaceAlgo algo;
+        if (!parseAlgo(name, algo)) return false;
+        algos.push_back(algo);
+    }
+    return !algos.empty();
+}
+
+template <typename T>
+bool parseNumber(const string& text, T& out) {
+    const auto [ptr, ec] = from_chars(text.data(), text.data() + text.size(), out);
+    return ec == errc() && ptr == text.data() + text.size();
+}
+
+// "N" or "N:ALGO", e.g. "64:clock", for a hierarchy tier.
+bool parseTier(const string& text, TierConfig& tier) {
+    const auto colon = text.find(':');
+    if (colon != string::npos && !parseAlgo(text.substr(colon + 1), tier.algo)) return false;
+    return parseNumber(text.substr(0, colon), tier.entries) && tier.entries > 0;
+}
+
+// Comma-separated page sizes in bytes with an optional K, M or G suffix, e.g. "4K,2M,1G", as
+// shift amounts. Each must be a power of two.
+bool parsePageSizes(const string& text, vector<unsigned>& shifts) {
+    shifts.clear();
+    istringstream iss(text);
+    string item;
+    while (getline(iss, item, ',')) {
+        unsigned scale = 0;
+        if (!item.empty()) {
+            switch (toupper(static_cast<unsigned char>(item.back()))) {
+                case 'K': scale = 10; break;
+                case 'M': scale = 20; break;
+                case 'G': scale = 30; break;
+                default: break;
+            }
+            if (scale) item.pop_back();
+        }
+        uint64_t size;
+        if (!parseNumber(item, size) || size == 0 || (size & (size - 1)) != 0) return false;
+        const auto shift = static_cast<unsigned>(countr_zero(size)) + scale;
+        if (shift >= 64) return false;
+        shifts.push_back(shift);
+    }
+    return !shifts.empty();
+}
+
+struct CliOptions {
+    string command;
+    vector<ReplaceAlgo> algos = {ReplaceAlgo::Lru_algo};
+    int frames                = 0;
+    std::size_t sampleEvery   = 0;
+    std::size_t checkpoint    = 1024;
+    PolicyConfig config;
+    CostModel cost;
+    string input;  // trace file, text or binary; stdin text when empty
+    string output; // convert only
+    trace::Encoding encoding = trace::Encoding::Raw;
+    uint32_t blockRefs       = 4096;
+    unsigned threads         = 0; // sweep; 0 uses every hardware thread
+    vector<unsigned> pageShifts;  // when set, the trace holds addresses, cut at each page size
+    PrefetchConfig prefetch;
+    HierarchyConfig hierarchy; // hierarchy; RAM uses --frames and the first --algo
+};
+
+void printUsage(const char* prog) {
+    cout << "Usage: " << prog << "                            interactive menu\n"
+            << "       " << prog << " summary [options] < trace  counters only, constant memory\n"
+            << "       " << prog << " steps [options] < trace    full step table from a delta log\n"
+            << "       " << prog << " mrc [options] < trace      LRU and OPT faults for every frame count; LRU takes\n"
+            << "                                  O(n log n), OPT O(n x frames), so on large traces give\n"
+            << "                                  --frames or --algo lru\n"
+            << "       " << prog << " compare [options] < trace  faults and throughput of several algorithms\n"
+            << "       " << prog << " wss --tau N < trace        working-set size over time\n"
+            << "       " << prog << " sweep --frames N < trace   per-frame-count runs on all cores, flags Belady's anomaly\n"
+            << "       " << prog << " belady --frames N < trace  every k < N where k+1 frames fault more, with witnesses\n"
+            << "       " << prog << " hierarchy --frames N < trace  TLB, RAM and swap hit rates and AMAT\n"
+            << "       " << prog << " convert --output FILE < trace  write a binary trace\n"
+            << "       " << prog << " bench                      time the frame lookup methods\n"
+            << "\nOptions:\n"
+            << "  --input FILE    read the trace from FILE (text or binary, memory-mapped) instead of stdin\n"
+            << "  --output FILE   binary trace written by convert\n"
+            << "  --encoding E    convert output encoding: raw (mapped in place), varint, or delta\n"
+            << "                  (compressed blocks, streamed by summary; default raw)\n"
+            << "  --block N       references per delta block (default 4096)\n"
+            << "  --threads N     sweep worker threads (default: hardware threads)\n"
+            << "  --prefetch P    summary, compare, sweep: next (the pages after each fault) or readahead\n"
+            << "                  (sequential windows that grow while the stream lasts)\n"
+            << "  --prefetch-depth N  pages per fault for next, first window for readahead (default 4)\n"
+            << "  --prefetch-max N    largest readahead window (default 32)\n"
+            << "  --tlb N[:A]     hierarchy: TLB entries and policy (default 64:LRU)\n"
+            << "  --swap N[:A]    hierarchy: swap slots and policy (default 4 x frames, LRU)\n"
+            << "  --tlb-ns X, --walk-ns X, --swap-ns X  hierarchy: TLB lookup, page walk and swap-in\n"
+            << "                  latencies (default 1, 50, 10000); RAM is --hit-ns, disk --fault-ns\n"
+            << "  --page-size S[,S...]  read the trace as virtual addresses (decimal or 0x hex) and run\n"
+            << "                  the command once per page size, e.g. 4K,2M,1G\n"
+            << "  --algo A[,B...] algorithms, compare runs every one listed (default LRU; compare: all;\n"
+            << "                  mrc: LRU and OPT, the only ones it can draw; belady: FIFO)\n"
+            << "  --frames N      frame count (mrc: largest frame count, default distinct pages)\n"
+            << "  --sample N      also print the frames after every N-th reference\n"
+            << "  --checkpoint N  steps between full frame copies in the delta log (default 1024)\n"
+            << "  --lirs-ghosts N cap on LIRS non-resident entries (default 2 x frames)\n"
+            << "  --lfu-halve N   halve LFU use counts every N references (default never)\n"
+            << "  --aging-tick N  references between aging counter shifts (default frame count)\n"
+            << "  --aging-bits N  aging counter width: 8, 16 or 32 (default 8)\n"
+            << "  --hit-ns X      memory access latency for the effective access time (default 100)\n"
+            << "  --fault-ns X    page-in latency (default 100000)\n"
+            << "  --writeback-ns X  dirty page write-back latency (default 100000)\n"
+            << "  --tau N         working-set window in references (WSClock default: frame count)\n"
+            << "\nAlgorithms:";
+    for (const auto algo : allAlgos) cout << " " << algoName(algo);
+    cout << "\n";
+}
+
+bool parseCli(int argc, char* argv[], CliOptions& opts) {
+    opts.command = argv[1];
+    if (opts.command == "compare" || opts.command == "sweep") opts.algos = allAlgos;
+    if (opts.command == "mrc") opts.algos = {ReplaceAlgo::Lru_algo, ReplaceAlgo::Opt_algo};
+    if (opts.command == "belady") opts.algos = {ReplaceAlgo::Fifo_algo};
+    bool algoGiven = false;
+    for (int i = 2; i < argc; i += 2) {
+        const string arg = argv[i];
+        if (i + 1 >= argc) {
+            cerr << "Missing value for " << arg << "\n";
+            return false;
+        }
+        const string value = argv[i + 1];
+        bool ok;
+        if (arg == "--algo") ok = algoGiven = parseAlgoList(value, opts.algos);
+        else if (arg == "--frames") ok = parseNumber(value, opts.frames) && opts.frames > 0;
+        else if (arg == "--sample") ok = parseNumber(value, opts.sampleEvery);
+        else if (arg == "--checkpoint") ok = parseNumber(value, opts.checkpoint) && opts.checkpoint > 0;
+        else if (arg == "--lirs-ghosts") ok = parseNumber(value, opts.config.lirsGhosts);
+        else if (arg == "--lfu-halve") ok = parseNumber(value, opts.config.lfuHalveEvery);
+        else if (arg == "--aging-tick") ok = parseNumber(value, opts.config.agingInterval);
+        else if (arg == "--aging-bits") {
+            ok = parseNumber(value, opts.config.agingBits)
+                 && (opts.config.agingBits == 8 || opts.config.agingBits == 16 || opts.config.agingBits == 32);
+        } else if (arg == "--hit-ns") ok = parseNumber(value, opts.cost.hitNs) && opts.cost.hitNs >= 0;
+        else if (arg == "--fault-ns") ok = parseNumber(value, opts.cost.faultNs) && opts.cost.faultNs >= 0;
+        else if (arg == "--writeback-ns") ok = parseNumber(value, opts.cost.writeBackNs) && opts.cost.writeBackNs >= 0;
+        else if (arg == "--tau") ok = parseNumber(value, opts.config.wsWindow) && opts.config.wsWindow > 0;
+        else if (arg == "--input") ok = !(opts.input = value).empty();
+        else if (arg == "--output") ok = !(opts.output = value).empty();
+        else if (arg == "--encoding") {
+            ok = value == "raw" || value == "varint" || value == "delta";
+            opts.encoding = value == "varint" ? trace::Encoding::Varint
+                            : value == "delta" ? trace::Encoding::Delta : trace::Encoding::Raw;
+        } else if (arg == "--threads") ok = parseNumber(value, opts.threads);
+        else if (arg == "--page-size") ok = parsePageSizes(value, opts.pageShifts);
+        else if (arg == "--tlb") ok = parseTier(value, opts.hierarchy.tlb);
+        else if (arg == "--swap") ok = parseTier(value, opts.hierarchy.swap);
+        else if (arg == "--tlb-ns") ok = parseNumber(value, opts.hierarchy.tlb.ns) && opts.hierarchy.tlb.ns >= 0;
+        else if (arg == "--walk-ns") ok = parseNumber(value, opts.hierarchy.walkNs) && opts.hierarchy.walkNs >= 0;
+        else if (arg == "--swap-ns") ok = parseNumber(value, opts.hierarchy.swap.ns) && opts.hierarchy.swap.ns >= 0;
+        else if (arg == "--prefetch") {
+            ok = value == "next" || value == "readahead";
+            opts.prefetch.kind = value == "next" ? PrefetchKind::NextN : PrefetchKind::Readahead;
+        } else if (arg == "--prefetch-depth") ok = parseNumber(value, opts.prefetch.degree) && opts.prefetch.degree > 0;
+        else if (arg == "--prefetch-max") ok = parseNumber(value, opts.prefetch.maxWindow) && opts.prefetch.maxWindow > 0;
+        else if (arg == "--block") ok = parseNumber(value, opts.blockRefs) && opts.blockRefs > 0;
+        else {
+            cerr << "Unknown option: " << arg << "\n";
+            return false;
+        }
+        if (!ok) {
+            cerr << "Invalid value for " << arg << ": " << value << "\n";
+            return false;
+        }
+    }
+    if (!algoGiven && opts.prefetch.kind != PrefetchKind::None) {
+        // The default list includes OPT, which cannot prefetch.
+        erase(opts.algos, ReplaceAlgo::Opt_algo);
+    }
+    return true;
+}
+
+bool loadTrace(const CliOptions& opts, trace::TraceSource& source, bool stream = false) {
+    if (opts.input.empty()) {
+        trace::RefTrace trace;
+        if (!trace::readText(cin, trace)) return false;
+        source.assign(move(trace));
+        return true;
+    }
+    string error;
+    if (!source.open(opts.input.c_str(), error, stream)) {
+        cerr << "Cannot read trace: " << error << "\n";
+        return false;
+    }
+    return true;
+}
+
+// Rejects missing or conflicting options before any trace is read.
+bool checkCommand(const CliOptions& opts) {
+    const string& cmd = opts.command;
+    if ((cmd == "summary" || cmd == "steps" || cmd == "compare" || cmd == "sweep" || cmd == "belady"
+         || cmd == "hierarchy") && opts.frames <= 0) {
+        cerr << "--frames is required\n";
+        return false;
+    }
+    if (cmd == "hierarchy" && opts.hierarchy.swap.algo == ReplaceAlgo::Opt_algo) {
+        cerr << "OPT cannot run in the swap tier, which only sees RAM faults\n";
+        return false;
+    }
+    if (cmd == "mrc") {
+        for (const auto algo : opts.algos) {
+            if (algo != ReplaceAlgo::Lru_algo && algo != ReplaceAlgo::Opt_algo) {
+                cerr << "mrc draws LRU and OPT curves only; sweep runs the other algorithms\n";
+                return false;
+            }
+        }
+    }
+    if (cmd == "belady"
+        && (opts.algos.front() == ReplaceAlgo::Opt_algo || opts.algos.front() == ReplaceAlgo::Lru_algo)) {
+        cerr << algoName(opts.algos.front()) << " is a stack algorithm and cannot show Belady's anomaly\n";
+        return false;
+    }
+    if (cmd == "wss" && opts.config.wsWindow == 0) {
+        cerr << "--tau is required\n";
+        return false;
+    }
+    if (opts.prefetch.kind != PrefetchKind::None) {
+        if (cmd != "summary" && cmd != "compare" && cmd != "sweep") {
+            cerr << "--prefetch applies to summary, compare and sweep\n";
+            return false;
+        }
+        if (find(opts.algos.begin(), opts.algos.end(), ReplaceAlgo::Opt_algo) != opts.algos.end()) {
+            cerr << "OPT cannot be combined with --prefetch\n";
+            return false;
+        }
+    }
+    if (cmd == "convert" && opts.output.empty()) {
+        cerr << "--output is required\n";
+        return false;
+    }
+    if (cmd == "convert" && opts.pageShifts.size() > 1) {
+        cerr << "convert takes a single --page-size\n";
+        return false;
+    }
+    return true;
+}
+
+// Runs a command that needs the whole trace in memory. `pages` is set when the trace was cut
+// from addresses.
+int runCommand(const CliOptions& opts, const trace::TraceView& trace, const PageNumbering& pages = {}) {
+    const PageNames names   = pages.numbers;
+    PrefetchConfig prefetch = opts.prefetch;
+    prefetch.pages          = pages;
+
+    if (opts.command == "summary" || opts.command == "steps") {
+        const auto algo  = opts.algos.front();
+        const auto state = newAlgoState(algo, opts.frames, opts.config);
+        cout << algoName(algo) << " with " << opts.frames << " frames on "
+                << trace.pages.size() << " references.\n\n";
+        if (opts.command == "summary") {
+            printSummary(simulateSummary(*state, opts.frames, trace.pages, trace.writes, opts.sampleEvery, prefetch),
+                         opts.cost, names);
+        } else {
+            printResults(simulateLog(*state, opts.frames, trace.pages, trace.writes, opts.checkpoint), trace.pages,
+                         names);
+            cout << "Write-backs: " << state->writeBacks() << "\n";
+        }
+        state->printStats(cout);
+        return 0;
+    }
+
+    if (opts.command == "compare") {
+        cout << "Comparing with " << opts.frames << " frames on " << trace.pages.size() << " references.\n\n";
+        printComparison(opts.algos, opts.frames, trace.pages, trace.writes, opts.config, opts.cost, prefetch);
+        return 0;
+    }
+
+    if (opts.command == "mrc") {
+        const auto refs      = trace.pages;
+        const auto maxFrames = static_cast<std::size_t>(opts.frames);
+        vector<pair<string, MissRatioCurve>> curves;
+        for (const auto algo : opts.algos) {
+            curves.emplace_back(algoName(algo), algo == ReplaceAlgo::Lru_algo ? lruMissRatioCurve(refs, maxFrames)
+                                                                               : optMissRatioCurve(refs, maxFrames));
+        }
+        cout << "Miss-ratio curves over " << refs.size() << " references.\n\n";
+        printCurves(curves);
+        return 0;
+    }
+
+    if (opts.command == "sweep") {
+        const auto start  = chrono::steady_clock::now();
+        const auto curves = sweepMissRatioCurves(opts.algos, static_cast<std::size_t>(opts.frames), trace.pages,
+                                                 trace.writes, opts.config, opts.threads, prefetch);
+        const chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+        cout << opts.algos.size() * static_cast<std::size_t>(opts.frames) << " runs over " << trace.pages.size()
+                << " references in " << elapsed.count() << " ms.\n\n";
+        vector<pair<string, MissRatioCurve>> named;
+        for (std::size_t a = 0; a < opts.algos.size(); ++a) named.emplace_back(algoName(opts.algos[a]), curves[a]);
+        printCurves(named);
+        cout << "\nBelady's anomaly:\n";
+        for (const auto& [name, curve] : named) {
+            cout << "  " << left << setw(8) << name;
+            const auto ks = beladyAnomalies(curve);
+            if (ks.empty()) cout << " none";
+            for (const auto k : ks) {
+                cout << " " << k << "->" << k + 1 << " (+" << curve.faults[k + 1] - curve.faults[k] << ")";
+            }
+            cout << "\n";
+        }
+        return 0;
+    }
+
+    if (opts.command == "belady") {
+        const auto algo = opts.algos.front();
+        const auto refs = trace.pages;
+        cout << algoName(algo) << " with 1.." << opts.frames << " frames on " << refs.size() << " references.\n\n";
+        printBeladyReport(findBeladyAnomalies(algo, static_cast<std::size_t>(opts.frames), refs, trace.writes,
+                                              opts.config),
+                          refs, names);
+        return 0;
+    }
+
+    if (opts.command == "hierarchy") {
+        HierarchyConfig config = opts.hierarchy;
+        config.ram    = TierConfig{opts.algos.front(), opts.frames, opts.cost.hitNs};
+        config.diskNs = opts.cost.faultNs;
+        cout << "TLB -> RAM -> swap over " << trace.pages.size() << " references.\n\n";
+        printHierarchy(simulateHierarchy(trace.pages, trace.writes, config, opts.config), config);
+        return 0;
+    }
+
+    if (opts.command == "wss") {
+        const auto refs = trace.pages;
+        WorkingSetTracker workingSet(opts.config.wsWindow);
+        SeriesSampler sizes(refs.size(), 20);
+        for (const int page : refs) {
+            workingSet.add(page);
+            sizes.add(workingSet.size());
+        }
+        cout << "Working-set size with tau " << opts.config.wsWindow << " over " << refs.size() << " references: ";
+        sizes.print(cout);
+        return 0;
+    }
+
+    // convert
+    ofstream out(opts.output, ios::binary);
+    if (!trace::writeBinary(out, trace, opts.encoding, opts.blockRefs) || !out.flush()) {
+        cerr << "Cannot write " << opts.output << "\n";
+        return 1;
+    }
+    cout << "Wrote " << trace.pages.size() << " references to " << opts.output << "\n";
+    return 0;
+}
+
+string pageSizeName(unsigned shift) {
+    if (shift >= 30 && shift % 10 == 0) return to_string(1ULL << (shift - 30)) + "G";
+    if (shift >= 20 && shift < 30) return to_string(1ULL << (shift - 20)) + "M";
+    if (shift >= 10 && shift < 20) return to_string(1ULL << (shift - 10)) + "K";
+    return to_string(1ULL << shift);
+}
+
+// Reads the trace as virtual addresses once and runs the command at every --page-size.
+int runAtPageSizes(const CliOptions& opts) {
+    trace::AddressTrace addresses;
+    if (opts.input.empty()) {
+        if (!trace::readText(cin, addresses)) return 1;
+    } else if (string error; !trace::readAddressFile(opts.input.c_str(), addresses, error)) {
+        cerr << "Cannot read trace: " << error << "\n";
+        return 1;
+    }
+
+    trace::RefTrace pages;
+    vector<uint64_t> names;
+    unordered_map<uint64_t, int> ids;
+    for (const unsigned shift : opts.pageShifts) {
+        if (!trace::pagesOf(addresses, shift, pages, names, ids)) {
+            cerr << "Too many distinct pages at page size " << pageSizeName(shift) << "\n";
+            return 1;
+        }
+        cout << "=== Page size " << pageSizeName(shift) << ": " << names.size() << " distinct pages ===\n";
+        if (const int rc = runCommand(opts, trace::asView(pages), PageNumbering{names, &ids})) return rc;
+        cout << "\n";
+    }
+    return 0;
+}
+
+int runCli(int argc, char* argv[]) {
+    CliOptions opts;
+    if (!parseCli(argc, argv, opts)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    if (opts.command == "bench") {
+        printLookupBench(1 << 22);
+        return 0;
+    }
+    const vector<string> traceCommands = {"summary", "steps", "compare", "mrc", "sweep", "belady", "wss", "hierarchy",
+                                          "convert"};
+    if (find(traceCommands.begin(), traceCommands.end(), opts.command) == traceCommands.end()) {
+        printUsage(argv[0]);
+        return opts.command == "help" || opts.command == "--help" ? 0 : 1;
+    }
+    if (!checkCommand(opts)) return 1;
+
+    ios::sync_with_stdio(false);
+    if (!opts.pageShifts.empty()) return runAtPageSizes(opts);
+
+    const auto algo   = opts.algos.front();
+    const bool stream = opts.command == "summary" && algo != ReplaceAlgo::Opt_algo;
+    trace::TraceSource source;
+    if (!loadTrace(opts, source, stream)) return 1;
+    if (const auto* blocks = source.blocks()) {
+        cout << algoName(algo) << " with " << opts.frames << " frames on " << blocks->size()
+                << " references, streamed in " << blocks->blockCount() << " blocks.\n\n";
+        const auto state = newAlgoState(algo, opts.frames, opts.config);
+        SimSummary summary;
+        if (!simulateSummary(*state, opts.frames, *blocks, summary, opts.sampleEvery, opts.prefetch)) {
+            cerr << "Corrupt delta block in " << opts.input << "\n";
+            return 1;
+        }
+        printSummary(summary, opts.cost);
+        state->printStats(cout);
+        return 0;
+    }
+    return runCommand(opts, source.view());
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1) {
+        return runCli(argc, argv);
+    }
+
     cout << "==== Page Replacement Simulator ====\n";
-    cout << "Algorithms: 1) FIFO  2) OPT  3) LRU  4) Run Tests\n";
+    cout << "Algorithms: 1) FIFO  2) OPT  3) LRU  4) Run Tests  5) CLOCK  6) Enhanced second chance\n"
+            << "            7) ARC  8) LIRS  9) 2Q  10) Linux active/inactive\n"
+            << "            11) LFU  12) WSClock  13) Aging\n";
     cout << "Enter 0 as algorithm choice to exit.\n\n";
 
     while (true) {
@@ -301,16 +3252,14 @@ int main() {
             continue;
         }
 
-        cout << "Enter reference string (space separated integers):\n";
+        cout << "Enter reference string (space separated integers, suffix w for a write):\n";
         cin.ignore(numeric_limits<streamsize>::max(), '\n');
         string line;
         getline(cin, line);
         istringstream iss(line);
-        vector<int> refs;
-        int value;
-        while (iss >> value) {
-            refs.push_back(value);
-        }
+        trace::RefTrace parsed;
+        if (!trace::readText(iss, parsed)) continue;
+        const auto& [refs, writes] = parsed;
 
         if (refs.empty()) {
             cout << "Reference string cannot be empty.\n";
@@ -321,8 +3270,10 @@ int main() {
         cout << "\nRunning " << algoName(algo) << " with "
                 << frames << " frames on " << refs.size() << " references.\n\n";
 
-        auto results = simulate(algo, frames, refs);
-        printResults(results);
+        const auto state = newAlgoState(algo, frames);
+        printResults(simulateLog(*state, frames, refs, writes), refs);
+        if (!writes.empty()) cout << "Write-backs: " << state->writeBacks() << "\n";
+        state->printStats(cout);
         cout << "\n";
     }
 }
@@ -0,0 +1,130 @@
+#ifndef SIMD_SEARCH_HPP
+#define SIMD_SEARCH_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE4_1__)
+#include <smmintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Small-array helpers: minimum search over unsigned counters and equality search over int32.
+// AVX2 is used when the target has it (configure with -DPR_NATIVE_ARCH=ON), else SSE4.1 or SSE2
+// (always there on x86-64), else plain loops.
+namespace simd {
+
+#if defined(__AVX2__)
+using Vec                      = __m256i;
+inline Vec load(const void* p) { return _mm256_loadu_si256(static_cast<const Vec*>(p)); }
+inline void store(void* p, Vec v) { _mm256_storeu_si256(static_cast<Vec*>(p), v); }
+inline uint32_t mask(Vec v) { return static_cast<uint32_t>(_mm256_movemask_epi8(v)); }
+
+inline Vec min(Vec a, Vec b, uint8_t) { return _mm256_min_epu8(a, b); }
+inline Vec min(Vec a, Vec b, uint16_t) { return _mm256_min_epu16(a, b); }
+inline Vec min(Vec a, Vec b, uint32_t) { return _mm256_min_epu32(a, b); }
+
+inline Vec eq(Vec a, Vec b, uint8_t) { return _mm256_cmpeq_epi8(a, b); }
+inline Vec eq(Vec a, Vec b, uint16_t) { return _mm256_cmpeq_epi16(a, b); }
+inline Vec eq(Vec a, Vec b, uint32_t) { return _mm256_cmpeq_epi32(a, b); }
+
+inline Vec splat(uint8_t v) { return _mm256_set1_epi8(static_cast<char>(v)); }
+inline Vec splat(uint16_t v) { return _mm256_set1_epi16(static_cast<short>(v)); }
+inline Vec splat(uint32_t v) { return _mm256_set1_epi32(static_cast<int>(v)); }
+
+template <typename Counter>
+constexpr bool vectorMin = true;
+#elif defined(__SSE2__)
+using Vec                      = __m128i;
+inline Vec load(const void* p) { return _mm_loadu_si128(static_cast<const Vec*>(p)); }
+inline void store(void* p, Vec v) { _mm_storeu_si128(static_cast<Vec*>(p), v); }
+inline uint32_t mask(Vec v) { return static_cast<uint32_t>(_mm_movemask_epi8(v)); }
+
+inline Vec min(Vec a, Vec b, uint8_t) { return _mm_min_epu8(a, b); }
+#if defined(__SSE4_1__)
+inline Vec min(Vec a, Vec b, uint16_t) { return _mm_min_epu16(a, b); }
+inline Vec min(Vec a, Vec b, uint32_t) { return _mm_min_epu32(a, b); }
+#endif
+
+inline Vec eq(Vec a, Vec b, uint8_t) { return _mm_cmpeq_epi8(a, b); }
+inline Vec eq(Vec a, Vec b, uint16_t) { return _mm_cmpeq_epi16(a, b); }
+inline Vec eq(Vec a, Vec b, uint32_t) { return _mm_cmpeq_epi32(a, b); }
+
+inline Vec splat(uint8_t v) { return _mm_set1_epi8(static_cast<char>(v)); }
+inline Vec splat(uint16_t v) { return _mm_set1_epi16(static_cast<short>(v)); }
+inline Vec splat(uint32_t v) { return _mm_set1_epi32(static_cast<int>(v)); }
+
+// SSE2 only has an unsigned minimum for bytes; the wider ones need SSE4.1.
+template <typename Counter>
+#if defined(__SSE4_1__)
+constexpr bool vectorMin = true;
+#else
+constexpr bool vectorMin = sizeof(Counter) == 1;
+#endif
+#endif
+
+// Index of the first smallest element of v[0, n), or n when n == 0. One pass finds the minimum
+// and a second finds where it is, so both stay branch-free and vectorizable.
+template <typename Counter>
+std::size_t minIndex(const Counter* v, std::size_t n) {
+    Counter best  = std::numeric_limits<Counter>::max();
+    std::size_t i = 0;
+#if defined(__SSE2__)
+    if constexpr (vectorMin<Counter>) {
+        constexpr std::size_t lanes = sizeof(Vec) / sizeof(Counter);
+        if (n >= lanes) {
+            Vec acc = load(v);
+            for (i = lanes; i + lanes <= n; i += lanes) acc = min(acc, load(v + i), Counter{});
+            Counter lane[lanes];
+            store(lane, acc);
+            for (const Counter c : lane) best = std::min(best, c);
+        }
+    }
+#endif
+    for (; i < n; ++i) best = std::min(best, v[i]);
+
+    i = 0;
+#if defined(__SSE2__)
+    constexpr std::size_t lanes = sizeof(Vec) / sizeof(Counter);
+    const Vec target            = splat(best);
+    for (; i + lanes <= n; i += lanes) {
+        if (const uint32_t hit = mask(eq(load(v + i), target, Counter{}))) {
+            return i + static_cast<std::size_t>(__builtin_ctz(hit)) / sizeof(Counter);
+        }
+    }
+#endif
+    return static_cast<std::size_t>(std::find(v + i, v + n, best) - v);
+}
+
+// Index of the first element of v[0, n) equal to key, or n. n must be a multiple of 8, so callers
+// pad their arrays with a value they never search for and no tail loop is needed.
+inline std::size_t findEqual(const int32_t* v, std::size_t n, int32_t key) {
+#if defined(__AVX2__)
+    const __m256i target = _mm256_set1_epi32(key);
+    for (std::size_t i = 0; i < n; i += 8) {
+        const __m256i hit = _mm256_cmpeq_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(v + i)), target);
+        if (const int mask = _mm256_movemask_ps(_mm256_castsi256_ps(hit))) return i + __builtin_ctz(mask);
+    }
+    return n;
+#elif defined(__SSE2__)
+    const __m128i target = _mm_set1_epi32(key);
+    for (std::size_t i = 0; i < n; i += 8) {
+        const __m128i lo = _mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(v + i)), target);
+        const __m128i hi = _mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(v + i + 4)), target);
+        const int mask   = _mm_movemask_ps(_mm_castsi128_ps(lo)) | _mm_movemask_ps(_mm_castsi128_ps(hi)) << 4;
+        if (mask) return i + __builtin_ctz(mask);
+    }
+    return n;
+#else
+    return static_cast<std::size_t>(std::find(v, v + n, key) - v);
+#endif
+}
+
+} // namespace simd
+
+#endif // SIMD_SEARCH_HPP
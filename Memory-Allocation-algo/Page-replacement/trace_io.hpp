@@ -0,0 +1,520 @@
+#ifndef TRACE_IO_HPP
+#define TRACE_IO_HPP
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Reading and writing reference traces. Text traces are whitespace-separated page numbers, each
+// optionally suffixed with r (read, the default) or w (write). Binary traces start with a
+// FileHeader; raw ones are used straight from the mapping, varint ones are decoded once and
+// delta-block ones can also be decoded a block at a time while the simulation runs.
+namespace trace {
+
+// A reference string; `writes` stays empty while no reference is a write.
+struct RefTrace {
+    std::vector<int> pages;
+    std::vector<uint8_t> writes;
+};
+
+// What the simulator consumes: either a RefTrace or a region of a mapped file.
+struct TraceView {
+    std::span<const int> pages;
+    std::span<const uint8_t> writes;
+};
+
+inline TraceView asView(const RefTrace& trace) { return {trace.pages, trace.writes}; }
+
+// A read-only private mapping of a whole file, advised for one sequential pass.
+class MappedFile {
+    const char* data_ = nullptr;
+    std::size_t size_ = 0;
+
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { close(); }
+
+    bool open(const char* path, std::string& error) {
+        close();
+        const int fd = ::open(path, O_RDONLY);
+        if (fd < 0) {
+            error = std::string(path) + ": " + std::strerror(errno);
+            return false;
+        }
+        struct stat st {};
+        if (fstat(fd, &st) != 0) {
+            error = std::string(path) + ": " + std::strerror(errno);
+            ::close(fd);
+            return false;
+        }
+        size_ = static_cast<std::size_t>(st.st_size);
+        if (size_ > 0) {
+            void* p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) {
+                error = std::string(path) + ": " + std::strerror(errno);
+                ::close(fd);
+                size_ = 0;
+                return false;
+            }
+            madvise(p, size_, MADV_SEQUENTIAL);
+            data_ = static_cast<const char*>(p);
+        }
+        ::close(fd); // the mapping keeps the file referenced
+        return true;
+    }
+
+    void close() {
+        if (data_) munmap(const_cast<char*>(data_), size_);
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    const char* data() const { return data_; }
+    std::size_t size() const { return size_; }
+};
+
+// ---- text ----
+
+// Splits an optional r (read, the default) or w (write) suffix off [first, last).
+inline bool splitAccess(const char* first, const char*& last, bool& write) {
+    write = false;
+    if (last == first) return false;
+    const char c = last[-1];
+    if (c == 'w' || c == 'W' || c == 'r' || c == 'R') {
+        write = c == 'w' || c == 'W';
+        --last;
+    }
+    return true;
+}
+
+// A page number, optionally suffixed with r or w.
+inline bool parseRef(const char* first, const char* last, int& page, bool& write) {
+    if (!splitAccess(first, last, write)) return false;
+    const auto [ptr, ec] = std::from_chars(first, last, page);
+    return ec == std::errc() && ptr == last;
+}
+
+// A virtual address, decimal or 0x-prefixed hex, optionally suffixed with r or w.
+inline bool parseAddress(const char* first, const char* last, uint64_t& address, bool& write) {
+    if (!splitAccess(first, last, write)) return false;
+    int base = 10;
+    if (last - first > 2 && first[0] == '0' && (first[1] == 'x' || first[1] == 'X')) {
+        first += 2;
+        base = 16;
+    }
+    const auto [ptr, ec] = std::from_chars(first, last, address, base);
+    return ec == std::errc() && ptr == last;
+}
+
+inline void appendRef(RefTrace& trace, int page, bool write) {
+    if (write && trace.writes.empty()) trace.writes.resize(trace.pages.size(), 0);
+    trace.pages.push_back(page);
+    if (write || !trace.writes.empty()) trace.writes.push_back(write);
+}
+
+// A trace of virtual addresses, to be cut into pages of any size later; see pagesOf.
+struct AddressTrace {
+    std::vector<uint64_t> addresses;
+    std::vector<uint8_t> writes; // empty while no reference is a write
+};
+
+inline bool appendToken(RefTrace& trace, const char* first, const char* last) {
+    int page;
+    bool write;
+    if (!parseRef(first, last, page, write)) return false;
+    appendRef(trace, page, write);
+    return true;
+}
+
+inline bool appendToken(AddressTrace& trace, const char* first, const char* last) {
+    uint64_t address;
+    bool write;
+    if (!parseAddress(first, last, address, write)) return false;
+    if (write && trace.writes.empty()) trace.writes.resize(trace.addresses.size(), 0);
+    trace.addresses.push_back(address);
+    if (write || !trace.writes.empty()) trace.writes.push_back(write);
+    return true;
+}
+
+inline bool isSpace(char c) { return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\f' || c == '\v'; }
+
+// Appends the references in [first, last). Returns false, after a warning, at the first token
+// that is not a reference.
+template <typename Trace>
+bool parseText(const char* first, const char* last, Trace& trace) {
+    while (true) {
+        while (first != last && isSpace(*first)) ++first;
+        if (first == last) return true;
+        const char* end = first;
+        while (end != last && !isSpace(*end)) ++end;
+        if (!appendToken(trace, first, end)) {
+            std::cerr << "Stopping at invalid reference '" << std::string_view(first, end - first) << "'\n";
+            return false;
+        }
+        first = end;
+    }
+}
+
+// Text from a stream, parsed a chunk at a time; a token cut by the chunk boundary is carried
+// over to the next chunk. Returns false, after a warning, at the first token that is not a
+// reference.
+template <typename Trace>
+bool readText(std::istream& in, Trace& trace) {
+    std::vector<char> buf(1 << 20);
+    std::size_t carry = 0;
+    while (true) {
+        if (carry == buf.size()) buf.resize(buf.size() * 2);
+        in.read(buf.data() + carry, static_cast<std::streamsize>(buf.size() - carry));
+        const std::size_t filled = carry + static_cast<std::size_t>(in.gcount());
+        const bool done          = filled == carry;
+        std::size_t cut          = filled;
+        if (!done) {
+            while (cut > 0 && !isSpace(buf[cut - 1])) --cut;
+        }
+        if (!parseText(buf.data(), buf.data() + cut, trace)) return false;
+        if (done) return true;
+        carry = filled - cut;
+        std::memmove(buf.data(), buf.data() + cut, carry);
+    }
+}
+
+// Cuts the addresses into 2^shift-byte pages. Page numbers are 64-bit and sparse, so they are
+// renumbered densely in order of first use into the int ids the policies index by; this keeps
+// page equality, which is all a policy can observe. numbers[id] is the page number behind an id
+// and ids its inverse. Fails if there are more than INT_MAX pages.
+inline bool pagesOf(const AddressTrace& trace, unsigned shift, RefTrace& out, std::vector<uint64_t>& numbers,
+                    std::unordered_map<uint64_t, int>& ids) {
+    ids.clear();
+    ids.reserve(1024);
+    numbers.clear();
+    out.pages.resize(trace.addresses.size());
+    out.writes = trace.writes;
+    for (std::size_t i = 0; i < trace.addresses.size(); ++i) {
+        const uint64_t page = shift < 64 ? trace.addresses[i] >> shift : 0;
+        const auto [it, inserted] = ids.try_emplace(page, static_cast<int>(ids.size()));
+        if (inserted) {
+            if (ids.size() > static_cast<std::size_t>(std::numeric_limits<int>::max())) return false;
+            numbers.push_back(page);
+        }
+        out.pages[i] = it->second;
+    }
+    return true;
+}
+
+// ---- binary ----
+
+enum class Encoding : uint32_t {
+    Raw    = 0, // native int32 page ids, usable in place
+    Varint = 1, // zigzag LEB128 page ids
+    Delta  = 2, // blocks of zigzag LEB128 deltas behind a block index, see BlockIndex
+};
+
+// Followed by `count` write flags when hasWrites is set, then the page ids at pagesOffset.
+struct FileHeader {
+    char magic[4] = {'P', 'R', 'T', '1'};
+    Encoding encoding = Encoding::Raw;
+    uint64_t count    = 0;
+    uint32_t hasWrites = 0;
+    uint32_t reserved  = 0;
+};
+static_assert(sizeof(FileHeader) == 24);
+static_assert(sizeof(int) == sizeof(int32_t));
+
+inline std::size_t pagesOffset(const FileHeader& h) {
+    const std::size_t end = sizeof(FileHeader) + (h.hasWrites ? h.count : 0);
+    return (end + alignof(int) - 1) / alignof(int) * alignof(int);
+}
+
+inline bool isBinary(const char* data, std::size_t size) {
+    return size >= sizeof(FileHeader) && std::memcmp(data, FileHeader{}.magic, 4) == 0;
+}
+
+inline uint32_t zigzag(int v) { return (static_cast<uint32_t>(v) << 1) ^ static_cast<uint32_t>(v >> 31); }
+inline int unzigzag(uint32_t v) { return static_cast<int>(v >> 1) ^ -static_cast<int>(v & 1); }
+
+inline void putVarint(std::vector<char>& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<char>(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+// Decodes one value from [p, last), or returns nullptr if it runs off the end.
+inline const unsigned char* getVarint(const unsigned char* p, const unsigned char* last, uint64_t& v) {
+    if (p != last && *p < 0x80) { // most deltas fit in one byte
+        v = *p;
+        return p + 1;
+    }
+    v = 0;
+    for (int shift = 0; p != last && shift < 64; shift += 7) {
+        const unsigned char byte = *p++;
+        v |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return p;
+    }
+    return nullptr;
+}
+
+// Delta encoding: directly after the FileHeader (no write flags there), then `blockCount` file
+// offsets, one per block. Each block holds up to blockRefs references; its first page is coded
+// against 0 so any block decodes on its own. A reference is zigzag(page - previous page), shifted
+// left by one with the write flag in bit 0 when the header's hasWrites is set.
+struct BlockIndex {
+    uint32_t blockRefs  = 4096;
+    uint32_t blockCount = 0;
+};
+
+inline void encodeBlocks(std::vector<char>& out, const TraceView& trace, uint32_t blockRefs) {
+    const std::size_t n = trace.pages.size();
+    BlockIndex index;
+    index.blockRefs  = blockRefs;
+    index.blockCount = static_cast<uint32_t>((n + blockRefs - 1) / blockRefs);
+    const std::size_t base = sizeof(FileHeader) + sizeof index;
+    std::vector<uint64_t> offsets;
+    std::vector<char> blocks;
+    blocks.reserve(n + n / 4);
+    for (std::size_t i = 0; i < n; ++i) {
+        if (i % blockRefs == 0) offsets.push_back(blocks.size());
+        const int prev = i % blockRefs ? trace.pages[i - 1] : 0;
+        const int delta = static_cast<int>(static_cast<uint32_t>(trace.pages[i]) - static_cast<uint32_t>(prev));
+        uint64_t v      = zigzag(delta);
+        if (!trace.writes.empty()) v = v << 1 | (trace.writes[i] ? 1 : 0);
+        putVarint(blocks, v);
+    }
+    const std::size_t start = base + offsets.size() * sizeof(uint64_t);
+    for (auto& offset : offsets) offset += start;
+    out.insert(out.end(), reinterpret_cast<const char*>(&index), reinterpret_cast<const char*>(&index + 1));
+    out.insert(out.end(), reinterpret_cast<const char*>(offsets.data()),
+               reinterpret_cast<const char*>(offsets.data() + offsets.size()));
+    out.insert(out.end(), blocks.begin(), blocks.end());
+}
+
+// Reads a delta-encoded trace in place; blocks can be decoded in any order.
+class BlockReader {
+    const char* data_ = nullptr;
+    std::size_t size_ = 0;
+    FileHeader header_;
+    BlockIndex index_;
+    const uint64_t* offsets_ = nullptr;
+
+public:
+    bool attach(const char* data, std::size_t size, std::string& error) {
+        std::memcpy(&header_, data, sizeof header_);
+        const std::size_t indexEnd = sizeof header_ + sizeof index_;
+        if (size < indexEnd) {
+            error = "truncated block index";
+            return false;
+        }
+        std::memcpy(&index_, data + sizeof header_, sizeof index_);
+        if (header_.count > size - indexEnd) { // every reference takes at least one byte
+            error = "truncated delta trace";
+            return false;
+        }
+        if (index_.blockRefs == 0
+            || index_.blockCount != (header_.count + index_.blockRefs - 1) / index_.blockRefs
+            || (size - indexEnd) / sizeof(uint64_t) < index_.blockCount) {
+            error = "corrupt block index";
+            return false;
+        }
+        data_    = data;
+        size_    = size;
+        offsets_ = reinterpret_cast<const uint64_t*>(data + indexEnd);
+        return true;
+    }
+
+    std::size_t size() const { return header_.count; }
+    std::size_t blockCount() const { return index_.blockCount; }
+    std::size_t blockRefs() const { return index_.blockRefs; }
+    bool hasWrites() const { return header_.hasWrites; }
+
+    // Replaces pages (and writes, for a trace with writes) with the contents of block b.
+    bool decode(std::size_t b, std::vector<int>& pages, std::vector<uint8_t>& writes) const {
+        const std::size_t first = b * index_.blockRefs;
+        const std::size_t n     = std::min<std::size_t>(index_.blockRefs, header_.count - first);
+        const uint64_t end      = b + 1 < index_.blockCount ? offsets_[b + 1] : size_;
+        if (offsets_[b] > end || end > size_) return false;
+        auto p          = reinterpret_cast<const unsigned char*>(data_ + offsets_[b]);
+        const auto last = reinterpret_cast<const unsigned char*>(data_ + end);
+        pages.resize(n);
+        writes.resize(header_.hasWrites ? n : 0);
+        uint32_t page = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            uint64_t v;
+            if (!(p = getVarint(p, last, v))) return false;
+            if (header_.hasWrites) {
+                writes[i] = v & 1;
+                v >>= 1;
+            }
+            page += static_cast<uint32_t>(unzigzag(static_cast<uint32_t>(v)));
+            pages[i] = static_cast<int>(page);
+        }
+        return true;
+    }
+};
+
+inline bool writeBinary(std::ostream& out, const TraceView& trace, Encoding encoding, uint32_t blockRefs = 4096) {
+    FileHeader header;
+    header.encoding  = encoding;
+    header.count     = trace.pages.size();
+    header.hasWrites = !trace.writes.empty();
+    out.write(reinterpret_cast<const char*>(&header), sizeof header);
+    if (encoding == Encoding::Delta) {
+        std::vector<char> bytes;
+        encodeBlocks(bytes, trace, blockRefs);
+        out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        return static_cast<bool>(out);
+    }
+    if (header.hasWrites) out.write(reinterpret_cast<const char*>(trace.writes.data()), trace.writes.size());
+    const std::size_t pad = pagesOffset(header) - sizeof header - (header.hasWrites ? header.count : 0);
+    out.write("\0\0\0", static_cast<std::streamsize>(pad));
+    if (encoding == Encoding::Raw) {
+        out.write(reinterpret_cast<const char*>(trace.pages.data()), trace.pages.size_bytes());
+    } else {
+        std::vector<char> bytes;
+        bytes.reserve(trace.pages.size() * 2);
+        for (const int page : trace.pages) putVarint(bytes, zigzag(page));
+        out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    }
+    return static_cast<bool>(out);
+}
+
+inline bool readAddressFile(const char* path, AddressTrace& trace, std::string& error) {
+    MappedFile file;
+    if (!file.open(path, error)) return false;
+    if (isBinary(file.data(), file.size())) {
+        error = "binary traces hold page ids, not addresses";
+        return false;
+    }
+    if (!parseText(file.data(), file.data() + file.size(), trace)) {
+        error = "not an address trace";
+        return false;
+    }
+    return true;
+}
+
+// A trace loaded from a file. Raw binary traces are viewed in the mapping without a copy; text
+// and varint traces are decoded into owned storage. Delta traces are decoded up front too,
+// unless opened for streaming, in which case blocks() hands out the reader instead.
+class TraceSource {
+    MappedFile file_;
+    RefTrace owned_;
+    TraceView view_;
+    BlockReader blocks_;
+    bool streaming_ = false;
+
+    bool openBinary(bool stream, std::string& error) {
+        FileHeader header;
+        std::memcpy(&header, file_.data(), sizeof header);
+        if (header.encoding == Encoding::Delta) {
+            if (!blocks_.attach(file_.data(), file_.size(), error)) return false;
+            if (stream) return streaming_ = true;
+            owned_.pages.reserve(blocks_.size());
+            if (blocks_.hasWrites()) owned_.writes.reserve(blocks_.size());
+            std::vector<int> pages;
+            std::vector<uint8_t> writes;
+            for (std::size_t b = 0; b < blocks_.blockCount(); ++b) {
+                if (!blocks_.decode(b, pages, writes)) {
+                    error = "corrupt delta block " + std::to_string(b);
+                    return false;
+                }
+                owned_.pages.insert(owned_.pages.end(), pages.begin(), pages.end());
+                owned_.writes.insert(owned_.writes.end(), writes.begin(), writes.end());
+            }
+            view_ = asView(owned_);
+            return true;
+        }
+        const std::size_t size = file_.size();
+        if (header.count > size) { // also keeps pagesOffset from overflowing
+            error = "truncated trace";
+            return false;
+        }
+        const std::size_t offset = pagesOffset(header);
+        if (offset > size) {
+            error = "truncated trace header";
+            return false;
+        }
+        if (header.hasWrites) {
+            view_.writes = {reinterpret_cast<const uint8_t*>(file_.data() + sizeof header), header.count};
+        }
+        if (header.encoding == Encoding::Raw) {
+            if ((size - offset) / sizeof(int) < header.count) {
+                error = "truncated raw trace";
+                return false;
+            }
+            view_.pages = {reinterpret_cast<const int*>(file_.data() + offset), header.count};
+            return true;
+        }
+        if (header.encoding != Encoding::Varint) {
+            error = "unknown trace encoding";
+            return false;
+        }
+        if (header.count > size - offset) { // every varint takes at least one byte
+            error = "truncated varint trace";
+            return false;
+        }
+        owned_.pages.resize(header.count);
+        auto p          = reinterpret_cast<const unsigned char*>(file_.data() + offset);
+        const auto last = reinterpret_cast<const unsigned char*>(file_.data() + size);
+        for (auto& page : owned_.pages) {
+            uint64_t v;
+            if (!(p = getVarint(p, last, v))) {
+                error = "truncated varint trace";
+                return false;
+            }
+            page = unzigzag(static_cast<uint32_t>(v));
+        }
+        view_.pages = owned_.pages;
+        return true;
+    }
+
+public:
+    // With stream set, a delta trace is left encoded for block-at-a-time reading.
+    bool open(const char* path, std::string& error, bool stream = false) {
+        owned_     = {};
+        view_      = {};
+        streaming_ = false;
+        if (!file_.open(path, error)) return false;
+        if (isBinary(file_.data(), file_.size())) return openBinary(stream, error);
+        const bool parsed = parseText(file_.data(), file_.data() + file_.size(), owned_);
+        file_.close();
+        if (!parsed) {
+            error = "not a page trace";
+            return false;
+        }
+        view_ = asView(owned_);
+        return true;
+    }
+
+    // Takes ownership of an already parsed trace, e.g. one read from stdin.
+    void assign(RefTrace trace) {
+        file_.close();
+        streaming_ = false;
+        owned_ = std::move(trace);
+        view_  = asView(owned_);
+    }
+
+    const TraceView& view() const { return view_; }
+    const BlockReader* blocks() const { return streaming_ ? &blocks_ : nullptr; }
+};
+
+} // namespace trace
+
+#endif // TRACE_IO_HPP